@@ -73,6 +73,9 @@ NS = {
     "trt": "http://www.onvif.org/ver10/media/wsdl",
     "tptz": "http://www.onvif.org/ver20/ptz/wsdl",
     "tt": "http://www.onvif.org/ver10/schema",
+    "tev": "http://www.onvif.org/ver10/events/wsdl",
+    "wsnt": "http://docs.oasis-open.org/wsn/b-2",
+    "tns1": "http://www.onvif.org/ver10/topics",
     "wsse": "http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-secext-1.0.xsd",
 }
 
@@ -130,14 +133,88 @@ class State:
         self.home_zoom = 0.0
         self.lock = threading.Lock()
         self.running = True
+        # PullPoint events. Every state change appends (seq, xml) to
+        # `events`; subscriptions remember the last seq they were sent.
+        self.event_cond = threading.Condition()
+        self.event_seq = 0
+        self.events = []
+        self.subscriptions = {}  # id -> {"seq": int, "expires": float}
+
+    # --- events ----------------------------------------------------------
+
+    def post_event(self):
+        """Queue a PTZController/PTZStatus notification with the current state."""
+        with self.lock:
+            moving = abs(self.pan_speed) + abs(self.tilt_speed) + abs(self.zoom_speed) > 0.001
+            pan, tilt, zoom = self.pan, self.tilt, self.zoom
+        msg = (
+            "<wsnt:NotificationMessage>"
+            '<wsnt:Topic Dialect="http://www.onvif.org/ver10/tev/topicExpression/ConcreteSet">'
+            "tns1:PTZController/PTZStatus</wsnt:Topic>"
+            "<wsnt:Message>"
+            f'<tt:Message UtcTime="{now_iso()}" PropertyOperation="Changed">'
+            '<tt:Source><tt:SimpleItem Name="ProfileToken" Value="MainProfile"/></tt:Source>'
+            "<tt:Data>"
+            f'<tt:SimpleItem Name="MoveStatus" Value="{"MOVING" if moving else "IDLE"}"/>'
+            f'<tt:SimpleItem Name="PanTilt" Value="{pan:.4f} {tilt:.4f}"/>'
+            f'<tt:SimpleItem Name="Zoom" Value="{zoom:.4f}"/>'
+            "</tt:Data></tt:Message></wsnt:Message>"
+            "</wsnt:NotificationMessage>"
+        )
+        with self.event_cond:
+            self.event_seq += 1
+            self.events.append((self.event_seq, msg))
+            del self.events[:-64]
+            self.event_cond.notify_all()
+
+    def subscribe(self, seconds):
+        with self.event_cond:
+            sub_id = uuid.uuid4().hex[:12]
+            self.subscriptions[sub_id] = {"seq": self.event_seq, "expires": time.time() + seconds}
+            return sub_id
+
+    def renew(self, sub_id, seconds):
+        with self.event_cond:
+            sub = self.subscriptions.get(sub_id)
+            if sub is None:
+                return False
+            sub["expires"] = time.time() + seconds
+            return True
+
+    def unsubscribe(self, sub_id):
+        with self.event_cond:
+            self.subscriptions.pop(sub_id, None)
+
+    def pull(self, sub_id, timeout, limit):
+        """Long-poll: wait up to `timeout` seconds for events newer than the
+        subscription's cursor. Returns None if the subscription is unknown."""
+        deadline = time.time() + timeout
+        with self.event_cond:
+            now = time.time()
+            for k in [k for k, v in self.subscriptions.items() if v["expires"] < now]:
+                del self.subscriptions[k]
+            sub = self.subscriptions.get(sub_id)
+            if sub is None:
+                return None
+            while self.event_seq == sub["seq"] and self.running:
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    break
+                self.event_cond.wait(remaining)
+            pending = [m for seq, m in self.events if seq > sub["seq"]][:limit]
+            sub["seq"] = self.event_seq
+            return pending
 
     # --- mutations -------------------------------------------------------
 
     def continuous_move(self, x, y, z):
         with self.lock:
+            was_moving = abs(self.pan_speed) + abs(self.tilt_speed) + abs(self.zoom_speed) > 0.001
             self.pan_speed = float(x)
             self.tilt_speed = float(y)
             self.zoom_speed = float(z)
+        if not was_moving:
+            self.post_event()
 
     def stop_motion(self, pantilt=True, zoom=True):
         with self.lock:
@@ -146,18 +223,21 @@ class State:
                 self.tilt_speed = 0.0
             if zoom:
                 self.zoom_speed = 0.0
+        self.post_event()
 
     def absolute_move(self, x, y, z):
         with self.lock:
             self.pan = clamp(float(x), -1.0, 1.0)
             self.tilt = clamp(float(y), -1.0, 1.0)
             self.zoom = clamp(float(z), 0.0, 1.0)
+        self.post_event()
 
     def relative_move(self, x, y, z):
         with self.lock:
             self.pan = clamp(self.pan + float(x), -1.0, 1.0)
             self.tilt = clamp(self.tilt + float(y), -1.0, 1.0)
             self.zoom = clamp(self.zoom + float(z), 0.0, 1.0)
+        self.post_event()
 
     def home(self):
         with self.lock:
@@ -185,8 +265,10 @@ class State:
             if token in self.presets:
                 _, p, t, z = self.presets[token]
                 self.pan, self.tilt, self.zoom = p, t, z
-                return True
-        return False
+            else:
+                return False
+        self.post_event()
+        return True
 
     def remove_preset(self, token):
         with self.lock:
@@ -376,6 +458,7 @@ class OnvifHandler(BaseHTTPRequestHandler):
                 f"<tt:Media><tt:XAddr>{base}/onvif/media_service</tt:XAddr></tt:Media>"
                 f"<tt:PTZ><tt:XAddr>{base}/onvif/ptz_service</tt:XAddr></tt:PTZ>"
                 f"<tt:Imaging><tt:XAddr>{base}/onvif/imaging_service</tt:XAddr></tt:Imaging>"
+                f"<tt:Events><tt:XAddr>{base}/onvif/events_service</tt:XAddr></tt:Events>"
                 "</tds:Capabilities></tds:GetCapabilitiesResponse>"
             )
         if op == "GetDeviceInformation":
@@ -514,6 +597,50 @@ class OnvifHandler(BaseHTTPRequestHandler):
             token = first_text(body, "PresetToken") or ""
             s.remove_preset(token)
             return soap_envelope("<tptz:RemovePresetResponse/>")
+        # ---- Events service (PullPoint) ----
+        if op == "CreatePullPointSubscription":
+            seconds = parse_duration(first_text(body, "InitialTerminationTime"), 60)
+            sub_id = s.subscribe(seconds)
+            address = f"http://{s.host}:{s.http_port}/onvif/subscription/{sub_id}"
+            print(f"[events] new subscription {sub_id}")
+            return soap_envelope(
+                f'<tev:CreatePullPointSubscriptionResponse xmlns:tev="{NS["tev"]}" xmlns:wsnt="{NS["wsnt"]}" '
+                f'xmlns:wsa5="{NS["a_norm"]}">'
+                f"<tev:SubscriptionReference><wsa5:Address>{address}</wsa5:Address></tev:SubscriptionReference>"
+                f"<wsnt:CurrentTime>{now_iso()}</wsnt:CurrentTime>"
+                f"<wsnt:TerminationTime>{now_iso()}</wsnt:TerminationTime>"
+                "</tev:CreatePullPointSubscriptionResponse>"
+            )
+        if op == "PullMessages":
+            sub_id = self.path.rsplit("/", 1)[-1]
+            timeout = parse_duration(first_text(body, "Timeout"), 5)
+            try:
+                limit = int(first_text(body, "MessageLimit") or "16")
+            except ValueError:
+                limit = 16
+            msgs = s.pull(sub_id, min(timeout, 30), limit)
+            if msgs is None:
+                return None
+            return soap_envelope(
+                f'<tev:PullMessagesResponse xmlns:tev="{NS["tev"]}" xmlns:wsnt="{NS["wsnt"]}" '
+                f'xmlns:tns1="{NS["tns1"]}">'
+                f"<tev:CurrentTime>{now_iso()}</tev:CurrentTime>"
+                f"<tev:TerminationTime>{now_iso()}</tev:TerminationTime>"
+                + "".join(msgs)
+                + "</tev:PullMessagesResponse>"
+            )
+        if op == "Renew":
+            sub_id = self.path.rsplit("/", 1)[-1]
+            if not s.renew(sub_id, parse_duration(first_text(body, "TerminationTime"), 60)):
+                return None
+            return soap_envelope(
+                f'<wsnt:RenewResponse xmlns:wsnt="{NS["wsnt"]}">'
+                f"<wsnt:TerminationTime>{now_iso()}</wsnt:TerminationTime>"
+                "</wsnt:RenewResponse>"
+            )
+        if op == "Unsubscribe":
+            s.unsubscribe(self.path.rsplit("/", 1)[-1])
+            return soap_envelope(f'<wsnt:UnsubscribeResponse xmlns:wsnt="{NS["wsnt"]}"/>')
         # ---- Imaging service ----
         if op == "Move":
             speed_el = None
@@ -595,6 +722,15 @@ def first_text(body: bytes, local_name: str) -> str:
     return ""
 
 
+def parse_duration(text: str, default: float) -> float:
+    """Parse the simple xs:duration forms ONVIF clients send (PT5S, PT1M30S)."""
+    m = re.fullmatch(r"PT(?:(\d+)H)?(?:(\d+)M)?(?:(\d+(?:\.\d+)?)S)?", (text or "").strip())
+    if not m or not any(m.groups()):
+        return default
+    h, mi, sec = m.groups()
+    return int(h or 0) * 3600 + int(mi or 0) * 60 + float(sec or 0)
+
+
 def read_xyz(body: bytes, container: str):
     """Extract PanTilt x/y and Zoom x from a <container> element."""
     px = py = pz = 0.0
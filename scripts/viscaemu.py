@@ -3,6 +3,7 @@
 import asyncio
 import os
 import binascii
+import socket
 import time
 
 def clamp(val, min_val, max_val):
@@ -329,16 +330,52 @@ class ViscaDevice(asyncio.Protocol):
         for dg in datagrams:
             self.receive_datagram(dg)
 
+class ViscaDiscovery(asyncio.DatagramProtocol):
+    '''Answers Sony "ENQ:network" discovery broadcasts on UDP 52380'''
+    def __init__(self, model='VISCAEMU', name='CAM1', mac='02-00-00-00-fe-dc'):
+        self.model = model
+        self.name = name
+        self.mac = mac
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def local_address(self, peer):
+        # Find the address of the interface that routes back to the peer
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+            s.connect(peer)
+            return s.getsockname()[0]
+
+    def datagram_received(self, data, addr):
+        if data != b'\x02ENQ:network\xff\x03':
+            return
+        print('discovery request from', addr)
+        fields = [f'MAC:{self.mac}', 'INFO:', f'MODEL:{self.model}',
+                  'SOFTVERSION:1.00', f'IPADR:{self.local_address(addr)}',
+                  'MASK:255.255.255.0', 'GATEWAY:0.0.0.0',
+                  f'NAME:{self.name}', 'WRITE:on']
+        reply = b'\x02' + b''.join(f.encode() + b'\xff' for f in fields) + b'\x03'
+        self.transport.sendto(reply, addr)
+
 loop = asyncio.new_event_loop()
 asyncio.set_event_loop(loop)
 coro = loop.create_server(ViscaDevice, '', 5678)
 server = loop.run_until_complete(coro)
 print('serving on', server.sockets[0].getsockname())
 
+discovery_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+discovery_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+discovery_sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+discovery_sock.bind(('', 52380))
+discovery, _ = loop.run_until_complete(
+    loop.create_datagram_endpoint(ViscaDiscovery, sock=discovery_sock))
+print('answering discovery on', discovery_sock.getsockname())
+
 try:
     loop.run_forever()
 except KeyboardInterrupt:
     print('exit')
 finally:
     server.close()
+    discovery.close()
     loop.close()
@@ -25,6 +25,7 @@
 #include <QObject>
 #include <QDesktopServices>
 #include <QUuid>
+#include <QApplication>
 #include "double-slider.hpp"
 #include "spinbox-ignorewheel.hpp"
 #include "moc_properties-view.cpp"
@@ -40,6 +41,7 @@
 #include <obs.h>
 #include <qtimer.h>
 #include <string>
+#include <algorithm>
 #include <obs-frontend-api.h>
 
 using namespace std;
@@ -100,6 +102,15 @@ void OBSPropertiesView::ReloadProperties()
 		obs_properties_apply_settings(properties.get(), settings);
 	}
 
+	/* Point the existing widgets at the new property definitions so that
+	 * RefreshProperties() can keep them; anything that has disappeared
+	 * forces a full rebuild. */
+	for (auto &child : children) {
+		child->property = obs_properties_get(properties.get(), child->name.c_str());
+		if (!child->property)
+			builtLayout.clear();
+	}
+
 	uint32_t flags = obs_properties_get_flags(properties.get());
 	deferUpdate = enableDefer && (flags & OBS_PROPERTIES_DEFER_UPDATE) != 0;
 
@@ -109,6 +120,47 @@ void OBSPropertiesView::ReloadProperties()
 #define NO_PROPERTIES_STRING QObject::tr("Basic.PropertiesWindow.NoProperties")
 
 void OBSPropertiesView::RefreshProperties()
+{
+	if (!widget || builtLayout.empty() || LayoutSignature() != builtLayout) {
+		RebuildProperties();
+		return;
+	}
+
+	int h, v, hend, vend;
+	GetScrollPos(h, v, hend, vend);
+
+	/* Same top level layout; only rebuild groups whose contents differ */
+	obs_property_t *property = obs_properties_first(properties.get());
+	for (; property; obs_property_next(&property)) {
+		if (obs_property_get_type(property) != OBS_PROPERTY_GROUP || !obs_property_visible(property))
+			continue;
+		if (GroupSignature(property) == builtGroups[obs_property_name(property)])
+			continue;
+		if (!RebuildGroup(property)) {
+			RebuildProperties();
+			return;
+		}
+	}
+
+	if (!UpdateValues()) {
+		RebuildProperties();
+		return;
+	}
+
+	SetScrollPos(h, v, hend, vend);
+	if (disableScrolling)
+		setMinimumHeight(widget->minimumSizeHint().height());
+
+	lastFocused.clear();
+	if (lastWidget) {
+		lastWidget->setFocus(Qt::OtherFocusReason);
+		lastWidget = nullptr;
+	}
+
+	emit PropertiesRefreshed();
+}
+
+void OBSPropertiesView::RebuildProperties()
 {
 	int h, v, hend, vend;
 	GetScrollPos(h, v, hend, vend);
@@ -156,6 +208,13 @@ void OBSPropertiesView::RefreshProperties()
 		layout->addWidget(noPropertiesLabel);
 	}
 
+	builtLayout = LayoutSignature();
+	builtGroups.clear();
+	for (property = obs_properties_first(properties.get()); property; obs_property_next(&property)) {
+		if (obs_property_get_type(property) == OBS_PROPERTY_GROUP)
+			builtGroups[obs_property_name(property)] = GroupSignature(property);
+	}
+
 	emit PropertiesRefreshed();
 }
 
@@ -236,6 +295,15 @@ OBSPropertiesView::OBSPropertiesView(OBSData settings_, const char *type_, Prope
 	QMetaObject::invokeMethod(this, "ReloadProperties", Qt::QueuedConnection);
 }
 
+QWidget *OBSPropertiesView::GetPropertyWidget(const char *name) const
+{
+	for (auto &child : children) {
+		if (strcmp(obs_property_name(child->property), name) == 0)
+			return child->widget;
+	}
+	return nullptr;
+}
+
 void OBSPropertiesView::SetDisabled(bool disabled)
 {
 	for (auto child : findChildren<QWidget *>()) {
@@ -1571,6 +1639,324 @@ void OBSPropertiesView::AddProperty(obs_property_t *property, QFormLayout *layou
 			lastWidget = widget;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Diffing refresh                                                           */
+
+static void AppendSig(std::string &sig, const char *str)
+{
+	if (str)
+		sig += str;
+	sig += '\x1f';
+}
+
+static void AppendSig(std::string &sig, double val)
+{
+	sig += std::to_string(val);
+	sig += '\x1f';
+}
+
+/* Current value of a setting, for property types whose widgets can't be
+ * updated in place and so are rebuilt whenever the value changes */
+static void AppendValueSig(std::string &sig, obs_data_t *settings, const char *name)
+{
+	OBSDataItemAutoRelease item = obs_data_item_byname(settings, name);
+	if (!item) {
+		AppendSig(sig, nullptr);
+		return;
+	}
+
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		AppendSig(sig, obs_data_item_get_string(item));
+		break;
+	case OBS_DATA_NUMBER:
+		AppendSig(sig, obs_data_item_get_double(item));
+		break;
+	case OBS_DATA_BOOLEAN:
+		AppendSig(sig, obs_data_item_get_bool(item) ? 1.0 : 0.0);
+		break;
+	case OBS_DATA_OBJECT: {
+		OBSDataAutoRelease obj = obs_data_item_get_obj(item);
+		AppendSig(sig, obj ? obs_data_get_json(obj) : nullptr);
+		break;
+	}
+	case OBS_DATA_ARRAY: {
+		OBSDataArrayAutoRelease array = obs_data_item_get_array(item);
+		for (size_t i = 0; i < obs_data_array_count(array); i++) {
+			OBSDataAutoRelease obj = obs_data_array_item(array, i);
+			AppendSig(sig, obs_data_get_json(obj));
+		}
+		break;
+	}
+	default:
+		AppendSig(sig, nullptr);
+	}
+}
+
+static void AppendPropertySig(std::string &sig, obs_property_t *prop, obs_data_t *settings, bool content)
+{
+	const char *name = obs_property_name(prop);
+	obs_property_type type = obs_property_get_type(prop);
+
+	AppendSig(sig, name);
+	AppendSig(sig, type);
+	AppendSig(sig, obs_property_description(prop));
+	AppendSig(sig, obs_property_long_description(prop));
+	AppendSig(sig, obs_property_visible(prop));
+	AppendSig(sig, obs_property_enabled(prop));
+
+	switch (type) {
+	case OBS_PROPERTY_INT:
+		AppendSig(sig, obs_property_int_type(prop));
+		AppendSig(sig, obs_property_int_min(prop));
+		AppendSig(sig, obs_property_int_max(prop));
+		AppendSig(sig, obs_property_int_step(prop));
+		AppendSig(sig, obs_property_int_suffix(prop));
+		break;
+	case OBS_PROPERTY_FLOAT:
+		AppendSig(sig, obs_property_float_type(prop));
+		AppendSig(sig, obs_property_float_min(prop));
+		AppendSig(sig, obs_property_float_max(prop));
+		AppendSig(sig, obs_property_float_step(prop));
+		AppendSig(sig, obs_property_float_suffix(prop));
+		break;
+	case OBS_PROPERTY_TEXT:
+		AppendSig(sig, obs_property_text_type(prop));
+		AppendSig(sig, obs_property_text_monospace(prop));
+		if (obs_property_text_type(prop) == OBS_TEXT_INFO) {
+			AppendSig(sig, obs_property_text_info_type(prop));
+			AppendSig(sig, obs_property_text_info_word_wrap(prop));
+			/* An empty info text changes the row layout, and one
+			 * with a long description is rendered as HTML */
+			if (obs_property_long_description(prop))
+				AppendValueSig(sig, settings, name);
+			else
+				AppendSig(sig, *obs_data_get_string(settings, name) ? 1.0 : 0.0);
+		}
+		break;
+	case OBS_PROPERTY_LIST: {
+		obs_combo_format format = obs_property_list_format(prop);
+		obs_combo_type list_type = obs_property_list_type(prop);
+		size_t count = obs_property_list_item_count(prop);
+		bool has_disabled = false;
+
+		AppendSig(sig, list_type);
+		AppendSig(sig, format);
+		for (size_t i = 0; i < count; i++) {
+			AppendSig(sig, obs_property_list_item_name(prop, i));
+			AppendSig(sig, QT_TO_UTF8(propertyListToQVariant(prop, i).toString()));
+			AppendSig(sig, obs_property_list_item_disabled(prop, i));
+			has_disabled |= obs_property_list_item_disabled(prop, i);
+		}
+		/* Radio buttons, auto-select annotations and the warning label
+		 * for a disabled selection are all fixed at build time */
+		if (list_type == OBS_COMBO_TYPE_RADIO || has_disabled)
+			AppendValueSig(sig, settings, name);
+		if (obs_data_has_autoselect_value(settings, name))
+			AppendSig(sig, QT_TO_UTF8(from_obs_data_autoselect(settings, name, format).toString()));
+		break;
+	}
+	case OBS_PROPERTY_PATH:
+		AppendSig(sig, obs_property_path_type(prop));
+		AppendSig(sig, obs_property_path_filter(prop));
+		AppendSig(sig, obs_property_path_default_path(prop));
+		break;
+	case OBS_PROPERTY_BUTTON:
+		AppendSig(sig, obs_property_button_type(prop));
+		AppendSig(sig, obs_property_button_url(prop));
+		break;
+	case OBS_PROPERTY_EDITABLE_LIST:
+		AppendSig(sig, obs_property_editable_list_type(prop));
+		AppendSig(sig, obs_property_editable_list_filter(prop));
+		AppendSig(sig, obs_property_editable_list_default_path(prop));
+		AppendValueSig(sig, settings, name);
+		break;
+	case OBS_PROPERTY_FRAME_RATE:
+		for (size_t i = 0; i < obs_property_frame_rate_options_count(prop); i++)
+			AppendSig(sig, obs_property_frame_rate_option_name(prop, i));
+		AppendSig(sig, obs_property_frame_rate_fps_ranges_count(prop));
+		AppendValueSig(sig, settings, name);
+		break;
+	case OBS_PROPERTY_COLOR:
+	case OBS_PROPERTY_COLOR_ALPHA:
+	case OBS_PROPERTY_FONT:
+		AppendValueSig(sig, settings, name);
+		break;
+	case OBS_PROPERTY_GROUP:
+		AppendSig(sig, obs_property_group_type(prop));
+		if (content) {
+			obs_properties_t *props = obs_property_group_content(prop);
+			sig += '{';
+			for (obs_property_t *el = obs_properties_first(props); el; obs_property_next(&el))
+				AppendPropertySig(sig, el, settings, true);
+			sig += '}';
+		}
+		break;
+	default:
+		break;
+	}
+	sig += '\x1e';
+}
+
+/* Top level properties only; the contents of groups are compared separately */
+std::string OBSPropertiesView::LayoutSignature() const
+{
+	std::string sig;
+	obs_property_t *property = obs_properties_first(properties.get());
+	for (; property; obs_property_next(&property))
+		AppendPropertySig(sig, property, settings, false);
+	return sig;
+}
+
+std::string OBSPropertiesView::GroupSignature(obs_property_t *group) const
+{
+	std::string sig;
+	AppendPropertySig(sig, group, settings, true);
+	return sig;
+}
+
+bool OBSPropertiesView::RebuildGroup(obs_property_t *group)
+{
+	const char *name = obs_property_name(group);
+	QGroupBox *groupBox = nullptr;
+	for (auto &child : children) {
+		if (child->property == group)
+			groupBox = qobject_cast<QGroupBox *>(child->widget);
+	}
+	QFormLayout *subLayout = groupBox ? qobject_cast<QFormLayout *>(groupBox->layout()) : nullptr;
+	if (!subLayout)
+		return false;
+
+	children.erase(std::remove_if(children.begin(), children.end(),
+				      [groupBox](const std::unique_ptr<WidgetInfo> &child) {
+					      return groupBox->isAncestorOf(child->widget);
+				      }),
+		       children.end());
+	while (subLayout->rowCount() > 0)
+		subLayout->removeRow(0);
+
+	obs_properties_t *content = obs_property_group_content(group);
+	for (obs_property_t *el = obs_properties_first(content); el; obs_property_next(&el))
+		AddProperty(el, subLayout);
+
+	builtGroups[name] = GroupSignature(group);
+	return true;
+}
+
+/* Push the current settings into the existing widgets. Returns false if a
+ * widget can't represent its value and the view needs rebuilding. */
+bool OBSPropertiesView::UpdateValues()
+{
+	bool ok = true;
+	updatingValues = true;
+	for (auto &child : children) {
+		if (!child->UpdateValue()) {
+			ok = false;
+			break;
+		}
+	}
+	updatingValues = false;
+	return ok;
+}
+
+bool WidgetInfo::UpdateValue()
+{
+	/* Don't fight the user over a control they are editing */
+	if (recently_updated || widget->hasFocus() || widget->isAncestorOf(QApplication::focusWidget()))
+		return true;
+
+	const char *setting = obs_property_name(property);
+	obs_data_t *settings = view->settings;
+
+	switch (obs_property_get_type(property)) {
+	case OBS_PROPERTY_BOOL: {
+		QCheckBox *checkbox = qobject_cast<QCheckBox *>(widget);
+		if (!checkbox)
+			return false;
+		checkbox->setChecked(obs_data_get_bool(settings, setting));
+		return true;
+	}
+	case OBS_PROPERTY_INT: {
+		QSpinBox *spin = qobject_cast<QSpinBox *>(widget);
+		if (!spin)
+			return false;
+		spin->setValue((int)obs_data_get_int(settings, setting));
+		return true;
+	}
+	case OBS_PROPERTY_FLOAT: {
+		QDoubleSpinBox *spin = qobject_cast<QDoubleSpinBox *>(widget);
+		if (!spin)
+			return false;
+		spin->setValue(obs_data_get_double(settings, setting));
+		return true;
+	}
+	case OBS_PROPERTY_TEXT: {
+		QString val = QT_UTF8(obs_data_get_string(settings, setting));
+		obs_text_type type = obs_property_text_type(property);
+		if (type == OBS_TEXT_MULTILINE) {
+			QPlainTextEdit *edit = qobject_cast<QPlainTextEdit *>(widget);
+			if (!edit)
+				return false;
+			if (edit->toPlainText() != val)
+				edit->setPlainText(val);
+		} else if (type == OBS_TEXT_INFO) {
+			QLabel *label = qobject_cast<QLabel *>(widget);
+			if (!label)
+				return false;
+			/* Formatted labels are covered by the signature */
+			if (obs_property_long_description(property))
+				return true;
+			if (val.isEmpty())
+				val = QT_UTF8(obs_property_description(property));
+			if (label->text() != val)
+				label->setText(val);
+		} else {
+			QLineEdit *edit = qobject_cast<QLineEdit *>(widget);
+			if (!edit)
+				return false;
+			if (edit->text() != val)
+				edit->setText(val);
+		}
+		return true;
+	}
+	case OBS_PROPERTY_PATH: {
+		QLineEdit *edit = qobject_cast<QLineEdit *>(widget);
+		if (!edit)
+			return false;
+		edit->setText(QT_UTF8(obs_data_get_string(settings, setting)));
+		return true;
+	}
+	case OBS_PROPERTY_LIST: {
+		QComboBox *combo = qobject_cast<QComboBox *>(widget);
+		if (!combo) /* radio buttons */
+			return true;
+		obs_combo_format format = obs_property_list_format(property);
+		QVariant value = from_obs_data(settings, setting, format);
+		if (combo->isEditable() && format == OBS_COMBO_FORMAT_STRING) {
+			if (combo->lineEdit()->text() != value.toString())
+				combo->lineEdit()->setText(value.toString());
+			return true;
+		}
+		int idx = combo->findData(value);
+		if (idx == -1)
+			return false;
+		combo->setCurrentIndex(idx);
+		return true;
+	}
+	case OBS_PROPERTY_GROUP: {
+		QGroupBox *groupBox = qobject_cast<QGroupBox *>(widget);
+		if (!groupBox)
+			return false;
+		if (groupBox->isCheckable())
+			groupBox->setChecked(obs_data_get_bool(settings, setting));
+		return true;
+	}
+	default:
+		/* Remaining types are rebuilt when their value changes */
+		return true;
+	}
+}
+
 void OBSPropertiesView::SignalChanged()
 {
 	emit Changed();
@@ -1949,6 +2335,10 @@ void WidgetInfo::TogglePasswordText(bool show)
 
 void WidgetInfo::ControlChanged()
 {
+	/* Signals from values pushed in by OBSPropertiesView::UpdateValues() */
+	if (view->updatingValues)
+		return;
+
 	const char *setting = obs_property_name(property);
 	obs_property_type type = obs_property_get_type(property);
 
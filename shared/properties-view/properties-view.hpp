@@ -7,6 +7,8 @@
 #include <QPointer>
 #include <vector>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 class QFormLayout;
 class OBSPropertiesView;
@@ -26,6 +28,7 @@ class WidgetInfo : public QObject {
 private:
 	OBSPropertiesView *view;
 	obs_property_t *property;
+	std::string name;
 	QWidget *widget;
 	QPointer<QTimer> update_timer;
 	bool recently_updated = false;
@@ -47,10 +50,13 @@ private:
 
 	void TogglePasswordText(bool checked);
 
+	bool UpdateValue();
+
 public:
 	inline WidgetInfo(OBSPropertiesView *view_, obs_property_t *prop, QWidget *widget_)
 		: view(view_),
 		  property(prop),
+		  name(obs_property_name(prop)),
 		  widget(widget_)
 	{
 	}
@@ -107,6 +113,19 @@ private:
 	bool enableDefer = true;
 	bool disableScrolling = false;
 
+	/* Signatures of the property definitions the widgets were built from.
+	 * RefreshProperties() compares against these to decide between
+	 * pushing values into the existing widgets and rebuilding them. */
+	std::string builtLayout;
+	std::unordered_map<std::string, std::string> builtGroups;
+	bool updatingValues = false;
+
+	std::string LayoutSignature() const;
+	std::string GroupSignature(obs_property_t *group) const;
+	void RebuildProperties();
+	bool RebuildGroup(obs_property_t *group);
+	bool UpdateValues();
+
 	template<typename Sender, typename SenderParent, typename... Args>
 	QWidget *NewWidget(obs_property_t *prop, Sender *widget, void (SenderParent::*signal)(Args...));
 
@@ -168,6 +187,8 @@ public:
 
 	inline obs_data_t *GetSettings() const { return settings; }
 
+	QWidget *GetPropertyWidget(const char *name) const;
+
 	inline void UpdateSettings()
 	{
 		if (callback)
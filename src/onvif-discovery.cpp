@@ -0,0 +1,238 @@
+/* ONVIF WS-Discovery scanner
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <QNetworkDatagram>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <QUrl>
+#include <QUuid>
+#include <obs-module.h>
+#include <qt-wrappers.hpp>
+#include "onvif-discovery.hpp"
+
+static const quint16 wsdPort = 3702;
+static const char wsdGroup[] = "239.255.255.250";
+static const char onvifScopePrefix[] = "onvif://www.onvif.org/";
+
+OnvifDiscovery::OnvifDiscovery()
+{
+	connect(&socket, &QUdpSocket::readyRead, this, &OnvifDiscovery::readPending);
+	/* UDP multicast is lossy, so the probe is repeated a few times */
+	probeTimer.setInterval(500);
+	connect(&probeTimer, &QTimer::timeout, this, &OnvifDiscovery::sendProbe);
+	deadline.setSingleShot(true);
+	deadline.setInterval(4000);
+	connect(&deadline, &QTimer::timeout, this, [this]() {
+		probeTimer.stop();
+		socket.close();
+		checkFinished();
+	});
+}
+
+void OnvifDiscovery::start()
+{
+	probeTimer.stop();
+	deadline.stop();
+	socket.close();
+	if (!socket.bind(QHostAddress(QHostAddress::AnyIPv4), 0)) {
+		blog(LOG_WARNING, "[obs-ptz] ONVIF discovery: cannot open UDP socket: %s",
+		     qPrintable(socket.errorString()));
+		emit finished();
+		return;
+	}
+	messageId = "uuid:" + QUuid::createUuid().toString(QUuid::WithoutBraces);
+	devices.clear();
+	pendingQueries.clear();
+	probesSent = 0;
+	sendProbe();
+	probeTimer.start();
+	deadline.start();
+}
+
+void OnvifDiscovery::stop()
+{
+	probeTimer.stop();
+	deadline.stop();
+	socket.close();
+	pendingQueries.clear();
+}
+
+void OnvifDiscovery::sendProbe()
+{
+	if (++probesSent >= 3)
+		probeTimer.stop();
+
+	QByteArray probe = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+			   "<e:Envelope xmlns:e=\"http://www.w3.org/2003/05/soap-envelope\""
+			   " xmlns:w=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\""
+			   " xmlns:d=\"http://schemas.xmlsoap.org/ws/2005/04/discovery\""
+			   " xmlns:dn=\"http://www.onvif.org/ver10/network/wsdl\">"
+			   "<e:Header><w:MessageID>" +
+			   messageId.toUtf8() +
+			   "</w:MessageID>"
+			   "<w:To e:mustUnderstand=\"true\">urn:schemas-xmlsoap-org:ws:2005:04:discovery</w:To>"
+			   "<w:Action e:mustUnderstand=\"true\">"
+			   "http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe</w:Action></e:Header>"
+			   "<e:Body><d:Probe><d:Types>dn:NetworkVideoTransmitter</d:Types></d:Probe></e:Body>"
+			   "</e:Envelope>";
+	socket.writeDatagram(probe, QHostAddress(QString(wsdGroup)), wsdPort);
+}
+
+void OnvifDiscovery::readPending()
+{
+	while (socket.hasPendingDatagrams()) {
+		QNetworkDatagram dg = socket.receiveDatagram();
+		handleProbeMatches(dg.data(), dg.senderAddress());
+	}
+}
+
+void OnvifDiscovery::handleProbeMatches(const QByteArray &datagram, const QHostAddress &sender)
+{
+	QXmlStreamReader xml(datagram);
+	Device dev;
+	QString xaddrs, scopes;
+	bool inMatch = false;
+
+	while (!xml.atEnd()) {
+		xml.readNext();
+		if (xml.isStartElement()) {
+			if (xml.name() == QLatin1String("ProbeMatch")) {
+				inMatch = true;
+				dev = Device();
+				xaddrs.clear();
+				scopes.clear();
+			} else if (inMatch && xml.name() == QLatin1String("Address")) {
+				dev.key = xml.readElementText().trimmed();
+			} else if (inMatch && xml.name() == QLatin1String("XAddrs")) {
+				xaddrs = xml.readElementText();
+			} else if (inMatch && xml.name() == QLatin1String("Scopes")) {
+				scopes = xml.readElementText();
+			}
+			continue;
+		}
+		if (!xml.isEndElement() || xml.name() != QLatin1String("ProbeMatch"))
+			continue;
+		inMatch = false;
+
+		/* A device may list several service addresses (IPv6, other
+		 * interfaces); prefer the first IPv4 one. */
+		QUrl url;
+		for (const QString &x : xaddrs.split(' ', Qt::SkipEmptyParts)) {
+			QUrl u(x);
+			if (!u.isValid())
+				continue;
+			if (url.isEmpty())
+				url = u;
+			if (QHostAddress(u.host()).protocol() == QAbstractSocket::IPv4Protocol) {
+				url = u;
+				break;
+			}
+		}
+		if (url.isEmpty()) {
+			url.setScheme("http");
+			url.setHost(sender.toString());
+			url.setPath("/onvif/device_service");
+		}
+		dev.host = url.host();
+		dev.port = url.port(80);
+		dev.deviceService = url.toString();
+		for (const QString &scope : scopes.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+			if (!scope.startsWith(onvifScopePrefix))
+				continue;
+			QString rest = scope.mid(sizeof(onvifScopePrefix) - 1);
+			if (rest.startsWith("name/"))
+				dev.name = QUrl::fromPercentEncoding(rest.mid(5).toUtf8());
+			else if (rest.startsWith("hardware/"))
+				dev.hardware = QUrl::fromPercentEncoding(rest.mid(9).toUtf8());
+		}
+		if (dev.key.isEmpty())
+			dev.key = QString("%1:%2").arg(dev.host).arg(dev.port);
+
+		/* Each probe is sent several times, so every camera answers
+		 * more than once */
+		if (devices.contains(dev.key))
+			continue;
+		devices.insert(dev.key, dev);
+		report(dev);
+		pendingQueries.enqueue(dev.key);
+		queryNext();
+	}
+}
+
+void OnvifDiscovery::report(const Device &dev, const QString &detail)
+{
+	QString what = detail;
+	if (what.isEmpty())
+		what = dev.hardware;
+	if (!dev.name.isEmpty() && dev.name != what)
+		what = what.isEmpty() ? dev.name : QString("%1 - %2").arg(what, dev.name);
+	if (what.isEmpty())
+		what = obs_module_text("PTZ.ONVIF.Name");
+	QString label = QString("%1 (%2:%3)").arg(what, dev.host).arg(dev.port);
+
+	OBSDataAutoRelease cfg = obs_data_create();
+	obs_data_set_string(cfg, "type", "onvif");
+	obs_data_set_string(cfg, "host", QT_TO_UTF8(dev.host));
+	obs_data_set_int(cfg, "port", dev.port);
+	if (!dev.name.isEmpty() || !detail.isEmpty())
+		obs_data_set_string(cfg, "name", QT_TO_UTF8(dev.name.isEmpty() ? detail : dev.name));
+	emit found(dev.key, label, cfg.Get());
+}
+
+void OnvifDiscovery::queryNext()
+{
+	while (activeQueries < maxQueries && !pendingQueries.isEmpty()) {
+		QString key = pendingQueries.dequeue();
+		const Device &dev = devices[key];
+
+		/* GetDeviceInformation normally needs credentials, which we
+		 * don't have yet. Cameras that refuse just keep the label
+		 * built from their discovery scopes. */
+		QNetworkRequest request(QUrl(dev.deviceService));
+		request.setHeader(QNetworkRequest::ContentTypeHeader, "application/soap+xml; charset=utf-8");
+		request.setTransferTimeout(3000);
+		QByteArray body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+				  "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\""
+				  " xmlns:tds=\"http://www.onvif.org/ver10/device/wsdl\">"
+				  "<s:Body><tds:GetDeviceInformation/></s:Body></s:Envelope>";
+		QNetworkReply *reply = manager.post(request, body);
+		activeQueries++;
+		connect(reply, &QNetworkReply::finished, this, [this, key, reply]() {
+			activeQueries--;
+			if (reply->error() == QNetworkReply::NoError)
+				handleDeviceInformation(key, reply->readAll());
+			reply->deleteLater();
+			queryNext();
+			checkFinished();
+		});
+	}
+}
+
+void OnvifDiscovery::handleDeviceInformation(const QString &key, const QByteArray &body)
+{
+	QString manufacturer, model;
+	QXmlStreamReader xml(body);
+	while (!xml.atEnd()) {
+		if (!xml.readNextStartElement())
+			continue;
+		if (xml.name() == QLatin1String("Manufacturer"))
+			manufacturer = xml.readElementText().trimmed();
+		else if (xml.name() == QLatin1String("Model"))
+			model = xml.readElementText().trimmed();
+	}
+	QString detail = QString("%1 %2").arg(manufacturer, model).trimmed();
+	if (!detail.isEmpty() && devices.contains(key))
+		report(devices[key], detail);
+}
+
+void OnvifDiscovery::checkFinished()
+{
+	if (!deadline.isActive() && activeQueries == 0 && pendingQueries.isEmpty())
+		emit finished();
+}
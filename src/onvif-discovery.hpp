@@ -0,0 +1,61 @@
+/* ONVIF WS-Discovery scanner
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QUdpSocket>
+#include <QTimer>
+#include <QHash>
+#include <QQueue>
+#include <QNetworkAccessManager>
+#include "ptz-discovery.hpp"
+
+/*
+ * Multicasts a WS-Discovery Probe for NetworkVideoTransmitter devices on
+ * udp/3702 and collects the ProbeMatch replies. Every device found is then
+ * asked for GetDeviceInformation so that the list shows make and model; at
+ * most maxQueries of those are in flight at once so a venue full of cameras
+ * doesn't get hit all at the same moment.
+ */
+class OnvifDiscovery : public PTZDiscovery {
+	Q_OBJECT
+
+private:
+	struct Device {
+		QString key;
+		QString host;
+		int port = 80;
+		QString name;
+		QString hardware;
+		QString deviceService;
+	};
+	static const int maxQueries = 4;
+
+	QUdpSocket socket;
+	QTimer probeTimer;
+	QTimer deadline;
+	int probesSent = 0;
+	QString messageId;
+	QHash<QString, Device> devices;
+	QQueue<QString> pendingQueries;
+	int activeQueries = 0;
+	QNetworkAccessManager manager;
+
+	void sendProbe();
+	void handleProbeMatches(const QByteArray &datagram, const QHostAddress &sender);
+	void queryNext();
+	void handleDeviceInformation(const QString &key, const QByteArray &body);
+	void report(const Device &dev, const QString &detail = QString());
+	void checkFinished();
+
+private slots:
+	void readPending();
+
+public:
+	OnvifDiscovery();
+	void start() override;
+	void stop() override;
+};
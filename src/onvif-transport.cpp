@@ -0,0 +1,181 @@
+/* Shared ONVIF HTTP transport
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <QUrl>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+#include <QHttp1Configuration>
+#endif
+#include <algorithm>
+#include "onvif-transport.hpp"
+#include "ptz-onvif.hpp"
+
+OnvifTransport *OnvifTransport::instance = nullptr;
+
+OnvifTransport::OnvifTransport()
+{
+	for (auto m : {&manager, &eventManager}) {
+		connect(m, &QNetworkAccessManager::authenticationRequired, this, &OnvifTransport::authRequired);
+		connect(m, &QNetworkAccessManager::finished, this, &OnvifTransport::replyFinished);
+	}
+}
+
+OnvifTransport *OnvifTransport::get()
+{
+	if (!instance)
+		instance = new OnvifTransport();
+	return instance;
+}
+
+/* Called at module unload, after all devices are gone */
+void OnvifTransport::release()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+/* Hosts are keyed the way QUrl spells them, which is what post() sees */
+static QString hostKey(const QString &host)
+{
+	QUrl u;
+	u.setHost(host);
+	return u.host();
+}
+
+/*
+ * Every device on a host asks for its own limit; the most conservative one
+ * wins.
+ */
+void OnvifTransport::setHostLimit(PTZOnvif *owner, const QString &hostName, int limit)
+{
+	QString host = hostKey(hostName);
+	for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+		if (it.key() != host && it->limits.remove(owner))
+			updateLimit(it.value());
+	}
+	Host &h = hosts[host];
+	h.limits.insert(owner, limit);
+	updateLimit(h);
+	pump(host);
+}
+
+void OnvifTransport::updateLimit(Host &h)
+{
+	int limit = connectionsPerHost;
+	for (int l : h.limits)
+		limit = std::min(limit, l);
+	h.limit = std::max(1, limit);
+}
+
+quint64 OnvifTransport::post(PTZOnvif *owner, const QString &url, const QByteArray &body, bool urgent, bool longPoll)
+{
+	QUrl u(url);
+	Request req{nextId++, owner, u.host(), QNetworkRequest(u), body, urgent, longPoll};
+	req.request.setHeader(QNetworkRequest::ContentTypeHeader, "application/soap+xml; charset=utf-8");
+	/* Surface failures in seconds instead of waiting on the OS TCP
+	 * timeout (~2 min). 10s is generous for an ONVIF SOAP exchange. */
+	req.request.setTransferTimeout(10000);
+	quint64 id = req.id;
+
+	if (longPoll) {
+		/* Each device has at most one pull outstanding, so these need
+		 * no queueing of their own */
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+		QHttp1Configuration http1;
+		http1.setNumberOfConnectionsPerHost(eventConnectionsPerHost);
+		req.request.setHttp1Configuration(http1);
+#endif
+		dispatch(std::move(req));
+		return id;
+	}
+
+	Host &h = hosts[req.host];
+	QQueue<Request> &q = h.queues[owner];
+	if (q.isEmpty())
+		h.turns.append(owner);
+	if (urgent) {
+		/* Ahead of normal requests, but behind earlier urgent ones so a
+		 * Stop can never overtake the move it is meant to end. */
+		auto pos = std::find_if(q.begin(), q.end(), [](const Request &r) { return !r.urgent; });
+		q.insert(pos, std::move(req));
+	} else {
+		q.enqueue(std::move(req));
+	}
+	pump(u.host());
+	return id;
+}
+
+void OnvifTransport::pump(const QString &host)
+{
+	Host &h = hosts[host];
+	while (h.active < h.limit && !h.turns.isEmpty()) {
+		PTZOnvif *owner = h.turns.takeFirst();
+		QQueue<Request> &q = h.queues[owner];
+		if (q.isEmpty())
+			continue;
+		Request req = q.dequeue();
+		if (!q.isEmpty())
+			h.turns.append(owner);
+		else
+			h.queues.remove(owner);
+		h.active++;
+		dispatch(std::move(req));
+	}
+}
+
+void OnvifTransport::dispatch(Request &&req)
+{
+	/* Authentication is carried in the SOAP envelope via WS-Security
+	 * UsernameToken. If a camera actually demands HTTP Digest,
+	 * authRequired() supplies it on demand, and the manager keeps the
+	 * challenge for the host so the other devices on it skip the extra
+	 * round trip. Sending a Basic Authorization header unconditionally
+	 * caused some firmwares to reject the request as ambiguous. */
+	QNetworkAccessManager &m = req.longPoll ? eventManager : manager;
+	QNetworkReply *reply = m.post(req.request, req.body);
+	inflight.insert(reply, std::move(req));
+}
+
+void OnvifTransport::authRequired(QNetworkReply *reply, QAuthenticator *authenticator)
+{
+	auto it = inflight.find(reply);
+	if (it == inflight.end() || !it->owner)
+		return;
+	authenticator->setUser(it->owner->username);
+	authenticator->setPassword(it->owner->password);
+}
+
+void OnvifTransport::replyFinished(QNetworkReply *reply)
+{
+	reply->deleteLater();
+	auto it = inflight.find(reply);
+	if (it == inflight.end())
+		return;
+	Request req = std::move(*it);
+	inflight.erase(it);
+
+	if (!req.longPoll)
+		hosts[req.host].active--;
+	if (req.owner)
+		req.owner->requestFinished(req.id, reply);
+	pump(req.host);
+}
+
+void OnvifTransport::cancelAll(PTZOnvif *owner)
+{
+	for (auto it = hosts.begin(); it != hosts.end(); ++it) {
+		it->queues.remove(owner);
+		it->turns.removeAll(owner);
+		if (it->limits.remove(owner))
+			updateLimit(it.value());
+	}
+	/* Replies already on the wire are left to finish; they are dropped in
+	 * replyFinished() because the owner pointer is cleared. */
+	for (auto it = inflight.begin(); it != inflight.end(); ++it) {
+		if (it->owner == owner)
+			it->owner = nullptr;
+	}
+}
@@ -0,0 +1,84 @@
+/* Shared ONVIF HTTP transport
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQueue>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QAuthenticator>
+
+class PTZOnvif;
+
+/*
+ * All ONVIF devices share one OnvifTransport so that cameras behind the same
+ * host (typically NVR channels) share one keep-alive connection pool and one
+ * cache of digest challenges, instead of every device negotiating its own.
+ *
+ * Requests are queued per host and per device. At most the configured number
+ * of requests per host are on the wire at once; when the host is busy, the
+ * devices sharing it take turns so one chatty device can't starve the
+ * others. Long-poll requests (event PullMessages) mostly sit idle on the
+ * camera, so they go through a second manager with its own, larger
+ * connection pool. Every device keeps its one pull in flight, and a host full
+ * of event subscriptions can never hold up a Stop.
+ */
+class OnvifTransport : public QObject {
+	Q_OBJECT
+
+private:
+	struct Request {
+		quint64 id;
+		QPointer<PTZOnvif> owner;
+		QString host;
+		QNetworkRequest request;
+		QByteArray body;
+		bool urgent;
+		bool longPoll;
+	};
+	struct Host {
+		QHash<PTZOnvif *, int> limits; // host_concurrency of each device on the host
+		int limit = 2;
+		int active = 0;
+		QList<PTZOnvif *> turns; // devices with queued requests, round robin
+		QHash<PTZOnvif *, QQueue<Request>> queues;
+	};
+
+	/* QNetworkAccessManager opens at most this many connections per host
+	 * and queues everything beyond that internally. */
+	static constexpr int connectionsPerHost = 6;
+	/* Pool for long-polls; enough for one pull per channel of a large NVR */
+	static constexpr int eventConnectionsPerHost = 64;
+
+	static OnvifTransport *instance;
+	QNetworkAccessManager manager;
+	QNetworkAccessManager eventManager;
+	QHash<QString, Host> hosts;
+	QHash<QNetworkReply *, Request> inflight;
+	quint64 nextId = 1;
+
+	OnvifTransport();
+	void updateLimit(Host &h);
+	void pump(const QString &host);
+	void dispatch(Request &&req);
+
+private slots:
+	void authRequired(QNetworkReply *reply, QAuthenticator *authenticator);
+	void replyFinished(QNetworkReply *reply);
+
+public:
+	static OnvifTransport *get();
+	static void release();
+
+	quint64 post(PTZOnvif *owner, const QString &url, const QByteArray &body, bool urgent = false,
+		     bool longPoll = false);
+	void cancelAll(PTZOnvif *owner);
+	void setHostLimit(PTZOnvif *owner, const QString &host, int limit);
+};
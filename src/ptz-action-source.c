@@ -7,9 +7,12 @@
  * This file implements an OBS source plugin that triggers PTZ device actions,
  * like recalling a preset or initiating a camera move.
  */
+#include <string.h>
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include <callback/signal.h>
+#include <util/darray.h>
+#include <util/threading.h>
 #include "ptz.h"
 
 enum ptz_action_trigger_type {
@@ -36,8 +39,21 @@ struct ptz_action_source_data {
 	double tilt_speed;
 	obs_source_t *src;
 	bool was_preview;
+	/* Set to the dispatcher generation while the source is in preview */
+	uint64_t preview_mark;
 };
 
+/*
+ * All action sources share one frontend event callback. On each preview
+ * change the dispatcher walks the preview and program scenes once, then
+ * runs the action of only those sources that just entered the preview.
+ */
+static struct {
+	pthread_mutex_t mutex;
+	DARRAY(struct ptz_action_source_data *) sources;
+	uint64_t generation;
+} dispatcher;
+
 static const char *ptz_action_source_get_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -92,56 +108,108 @@ static void ptz_action_source_activate(void *data)
 		ptz_action_source_do_action(context);
 }
 
-static bool is_ptz_in_preview(struct ptz_action_source_data *context)
+typedef DARRAY(obs_source_t *) source_array_t;
+
+static void mark_preview_cb(obs_source_t *parent, obs_source_t *child, void *data)
 {
-	obs_source_t *source = obs_frontend_get_current_preview_scene();
-	if (source) {
-		bool is_preview = ptz_scene_is_source_active(source, context->src);
-		obs_source_release(source);
-		return is_preview;
+	UNUSED_PARAMETER(parent);
+	if (strcmp(obs_source_get_id(child), "ptz_action_source") == 0) {
+		struct ptz_action_source_data *context = obs_obj_get_data(child);
+		if (context)
+			context->preview_mark = *(uint64_t *)data;
 	}
-	return false;
 }
 
-static bool is_ptz_device_id_active_in_program(uint32_t device_id)
+static void collect_program_cb(obs_source_t *parent, obs_source_t *child, void *data)
+{
+	UNUSED_PARAMETER(parent);
+	source_array_t *program = data;
+	obs_source_t *ref = obs_source_get_ref(child);
+	if (ref)
+		da_push_back(*program, &ref);
+}
+
+static bool is_ptz_device_id_active_in_program(uint32_t device_id, obs_source_t *program_scene,
+					       source_array_t *program)
 {
 	obs_source_t *cam_source = ptz_device_find_source_using_ptz_name(device_id);
 	if (!cam_source)
 		return false;
 
-	obs_source_t *program = obs_frontend_get_current_scene();
-	bool ptz_in_use = ptz_scene_is_source_active(program, cam_source);
-	obs_source_release(program);
+	bool ptz_in_use = cam_source == program_scene || da_find(*program, &cam_source, 0) != DARRAY_INVALID;
 	obs_source_release(cam_source);
 	return ptz_in_use;
 }
 
+static void ptz_action_source_dispatch(void)
+{
+	DARRAY(struct ptz_action_source_data) triggered;
+	source_array_t program;
+	da_init(triggered);
+	da_init(program);
+
+	/* Scenes are walked without the dispatcher lock held, as sources can
+	 * be destroyed (and unregister) from within scene locks */
+	uint64_t generation = ++dispatcher.generation;
+	obs_source_t *preview_scene = obs_frontend_get_current_preview_scene();
+	if (preview_scene) {
+		obs_source_enum_active_sources(preview_scene, mark_preview_cb, &generation);
+		obs_source_release(preview_scene);
+	}
+
+	pthread_mutex_lock(&dispatcher.mutex);
+	for (size_t i = 0; i < dispatcher.sources.num; i++) {
+		struct ptz_action_source_data *context = dispatcher.sources.array[i];
+		if (context->trigger != PTZ_ACTION_TRIGGER_PREVIEW_ACTIVE &&
+		    context->trigger != PTZ_ACTION_TRIGGER_PREVIEW_ONLY_ACTIVE)
+			continue;
+		bool is_preview = context->preview_mark == generation;
+		if (!context->was_preview && is_preview)
+			da_push_back(triggered, context);
+		context->was_preview = is_preview;
+	}
+	pthread_mutex_unlock(&dispatcher.mutex);
+
+	if (!triggered.num) {
+		da_free(triggered);
+		return;
+	}
+
+	/* Only walk the program scene if some source actually needs it */
+	bool need_program = false;
+	for (size_t i = 0; i < triggered.num; i++)
+		need_program |= triggered.array[i].trigger == PTZ_ACTION_TRIGGER_PREVIEW_ONLY_ACTIVE;
+	obs_source_t *program_scene = need_program ? obs_frontend_get_current_scene() : NULL;
+	if (program_scene)
+		obs_source_enum_active_sources(program_scene, collect_program_cb, &program);
+
+	for (size_t i = 0; i < triggered.num; i++) {
+		struct ptz_action_source_data *action = &triggered.array[i];
+		if (action->trigger == PTZ_ACTION_TRIGGER_PREVIEW_ONLY_ACTIVE &&
+		    is_ptz_device_id_active_in_program(action->device_id, program_scene, &program))
+			continue;
+		ptz_action_source_do_action(action);
+	}
+
+	for (size_t i = 0; i < program.num; i++)
+		obs_source_release(program.array[i]);
+	obs_source_release(program_scene);
+	da_free(program);
+	da_free(triggered);
+}
+
 static void ptz_action_source_fe_callback(enum obs_frontend_event event, void *data)
 {
-	struct ptz_action_source_data *context = data;
-	bool is_preview;
+	UNUSED_PARAMETER(data);
 
 	switch (event) {
 	case OBS_FRONTEND_EVENT_STUDIO_MODE_ENABLED:
 	case OBS_FRONTEND_EVENT_STUDIO_MODE_DISABLED:
 	case OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED:
-		switch (context->trigger) {
-		case PTZ_ACTION_TRIGGER_PREVIEW_ACTIVE:
-			is_preview = is_ptz_in_preview(context);
-			if (!context->was_preview && is_preview)
-				ptz_action_source_do_action(context);
-			context->was_preview = is_preview;
-			break;
-		case PTZ_ACTION_TRIGGER_PREVIEW_ONLY_ACTIVE:
-			is_preview = is_ptz_in_preview(context);
-			if (!context->was_preview && is_preview &&
-			    !is_ptz_device_id_active_in_program(context->device_id))
-				ptz_action_source_do_action(context);
-			context->was_preview = is_preview;
-			break;
-		default:
-			break;
-		};
+		ptz_action_source_dispatch();
+		break;
+	case OBS_FRONTEND_EVENT_EXIT:
+		obs_frontend_remove_event_callback(ptz_action_source_fe_callback, NULL);
 		break;
 	default:
 		return;
@@ -155,14 +223,21 @@ static void *ptz_action_source_create(obs_data_t *settings, obs_source_t *source
 	context->src = source;
 	ptz_action_source_update(context, settings);
 
-	obs_frontend_add_event_callback(ptz_action_source_fe_callback, context);
+	pthread_mutex_lock(&dispatcher.mutex);
+	da_push_back(dispatcher.sources, &context);
+	pthread_mutex_unlock(&dispatcher.mutex);
 
 	return context;
 }
 
 static void ptz_action_source_destroy(void *data)
 {
-	bfree(data);
+	struct ptz_action_source_data *context = data;
+
+	pthread_mutex_lock(&dispatcher.mutex);
+	da_erase_item(dispatcher.sources, &context);
+	pthread_mutex_unlock(&dispatcher.mutex);
+	bfree(context);
 }
 
 static bool ptz_action_source_device_changed_cb(obs_properties_t *props, obs_property_t *prop_camera,
@@ -275,5 +350,16 @@ struct obs_source_info ptz_action_source = {
 
 void ptz_load_action_source(void)
 {
+	pthread_mutex_init(&dispatcher.mutex, NULL);
+	da_init(dispatcher.sources);
+	obs_frontend_add_event_callback(ptz_action_source_fe_callback, NULL);
 	obs_register_source(&ptz_action_source);
 }
+
+/* Called at module unload; by then OBS has destroyed every source, so the
+ * list is empty and nothing else can take the lock. */
+void ptz_unload_action_source(void)
+{
+	da_free(dispatcher.sources);
+	pthread_mutex_destroy(&dispatcher.mutex);
+}
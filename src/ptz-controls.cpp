@@ -72,17 +72,21 @@ public:
 
 void PTZControls::autoselectDevice(OBSSource scene)
 {
-	auto active_src_cb = [](obs_source_t *, obs_source_t *child, void *data) {
-		auto index = static_cast<QModelIndex *>(data);
-		if (!index->isValid())
-			*index = ptzDeviceList.indexFromName(obs_source_get_name(child));
-	};
-	QModelIndex index = ptzDeviceList.indexFromName(obs_source_get_name(scene));
-	if (!index.isValid())
-		obs_source_enum_active_sources(scene, active_src_cb, &index);
+	/* Reuse the walk done by PTZListModel::onSceneChanged() when possible */
+	PTZActiveSources collected;
+	auto active = ptzDeviceList.activeSources(obs_source_get_name(scene));
+	if (!active) {
+		collected.collect(scene);
+		active = &collected;
+	}
 
-	if (index.isValid())
-		ui->cameraList->setCurrentIndex(index);
+	for (auto &name : active->ordered) {
+		QModelIndex index = ptzDeviceList.indexFromName(name);
+		if (index.isValid()) {
+			ui->cameraList->setCurrentIndex(index);
+			return;
+		}
+	}
 }
 
 void PTZControls::onFrontendEvent(enum obs_frontend_event event, void *ptr)
@@ -108,28 +112,28 @@ void PTZControls::handleFrontendEvent(enum obs_frontend_event event)
 		updateMoveControls();
 		break;
 	case OBS_FRONTEND_EVENT_SCENE_CHANGED:
+		ptzDeviceList.onSceneChanged();
 		if (autoselectEnabled() && !obs_frontend_preview_program_mode_active()) {
 			OBSSourceAutoRelease source = obs_frontend_get_current_scene();
 			autoselectDevice(source.Get());
 		}
-		ptzDeviceList.onSceneChanged();
 		updateMoveControls();
 		break;
 	case OBS_FRONTEND_EVENT_STUDIO_MODE_ENABLED:
+		ptzDeviceList.onSceneChanged();
 		if (autoselectEnabled()) {
 			OBSSourceAutoRelease source = obs_frontend_get_current_scene();
 			autoselectDevice(source.Get());
 		}
-		ptzDeviceList.onSceneChanged();
 		updateMoveControls();
 		break;
 	case OBS_FRONTEND_EVENT_STUDIO_MODE_DISABLED:
 	case OBS_FRONTEND_EVENT_PREVIEW_SCENE_CHANGED:
+		ptzDeviceList.onSceneChanged();
 		if (autoselectEnabled() && obs_frontend_preview_program_mode_active()) {
 			OBSSourceAutoRelease source = obs_frontend_get_current_preview_scene();
 			autoselectDevice(source.Get());
 		}
-		ptzDeviceList.onSceneChanged();
 		updateMoveControls();
 		break;
 	case OBS_FRONTEND_EVENT_EXIT:
@@ -924,6 +928,7 @@ void PTZControls::on_zoomButton_wide_released()
 void PTZControls::on_focusButton_auto_clicked(bool checked)
 {
 	setAutofocusEnabled(checked);
+	shown_autofocus = checked;
 	callCurrentDevice("ptz_set", "focus_af_enabled", checked);
 }
 
@@ -965,17 +970,19 @@ void PTZControls::updateMoveControls()
 	bool is_locked = liveMoveLockActive() &&
 			 ui->cameraList->currentIndex().data(PTZListModel::IsLockedRole).toBool();
 
-	ui->movementControlsWidget->setEnabled(!is_locked);
+	bool autofocus = ui->cameraList->currentIndex().data(PTZListModel::IsAutofocusRole).toBool();
+
 	ui->cameraList->update();
-	ui->presetListView->setEnabled(!is_locked);
+	if (shown_valid && is_locked == shown_locked && autofocus == shown_autofocus)
+		return;
+	shown_valid = true;
+	shown_locked = is_locked;
+	shown_autofocus = autofocus;
 
+	ui->movementControlsWidget->setEnabled(!is_locked);
+	ui->presetListView->setEnabled(!is_locked);
 	RefreshToolBarStyling(ui->ptzToolbar);
-
-	calldata cd = {};
-	calldata_set_string(&cd, "property", "focus_af_enabled");
-	callCurrentDevice("ptz_get", &cd);
-	setAutofocusEnabled(calldata_bool(&cd, "focus_af_enabled"));
-	calldata_free(&cd);
+	setAutofocusEnabled(autofocus);
 }
 
 void PTZControls::currentChanged(QModelIndex current, QModelIndex previous)
@@ -992,11 +999,16 @@ void PTZControls::currentChanged(QModelIndex current, QModelIndex previous)
 	focus_speed = focus_accel = 0.0;
 
 	ui->presetListView->setRootIndex(current);
+	shown_valid = false;
 	updateMoveControls();
 }
 
-void PTZControls::settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+void PTZControls::settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles)
 {
+	/* Only the lock and autofocus state affect the movement controls */
+	if (!roles.isEmpty() && !roles.contains(PTZListModel::IsLockedRole) &&
+	    !roles.contains(PTZListModel::IsAutofocusRole))
+		return;
 	auto index = ui->cameraList->currentIndex();
 	QItemSelectionRange range(topLeft, bottomRight);
 	if (range.contains(index))
@@ -49,6 +49,12 @@ private:
 	bool autoselect_enabled = false;
 	bool speed_ramp_enabled = false;
 
+	/* State the movement controls were last styled for; restyling is
+	 * skipped when a model update leaves both unchanged */
+	bool shown_valid = false;
+	bool shown_locked = false;
+	bool shown_autofocus = false;
+
 	// Current status
 	double pan_speed = 0.0;
 	double pan_accel = 0.0;
@@ -124,7 +130,7 @@ private slots:
 	void on_focusButton_onetouch_clicked();
 
 	void currentChanged(QModelIndex current, QModelIndex previous);
-	void settingsChanged(const QModelIndex &topleft, const QModelIndex &bottomRight);
+	void settingsChanged(const QModelIndex &topleft, const QModelIndex &bottomRight, const QList<int> &roles);
 
 	void presetUpdateActions();
 	void on_presetListView_activated(QModelIndex index);
@@ -7,10 +7,17 @@
 
 #include <obs.hpp>
 #include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
 #include "ptz-device.hpp"
 #include "ptz-list-model.hpp"
+#include "ptz-sources.hpp"
 #include "ptz.h"
 #include "protocol-helpers.hpp"
+#if defined(ENABLE_ONVIF)
+#include "onvif-transport.hpp"
+#endif
 
 /**
  * Lambda factory macro for the PTZ proc_handler methods. This macro
@@ -18,12 +25,12 @@
  * proc_handler calls.
  *
  * In this current implementation, the proc_handler can be called from
- * any thread, and the calldata method must decode the arguments and use
- * invokeMethod to call the real target. invokeMethod will check if it
- * was called from the object's thread. If it wasn't, and if the method
- * doesn't return anything, then the call is queued on the correct
- * thread. For methods that do return data, they aren't handled yet and
- * will log an error when calling from a different thread.
+ * any thread, and the calldata method must decode the arguments and
+ * post() a PTZCommand for the real target. post() runs the command
+ * immediately when called from the object's thread, and otherwise queues
+ * it on the command ring to be run on the correct thread. Methods that
+ * return data read the published state snapshot instead, which is safe
+ * from any thread.
  */
 #define ptz_ph_lambda(_method) [](void *p, calldata_t *cd) \
 	{ \
@@ -63,10 +70,8 @@ PTZDevice::PTZDevice(OBSData config) : QObject()
 	type = obs_data_get_string(config, "type");
 	settings = obs_data_create();
 	obs_data_release(settings);
-	statistics = obs_data_create();
-	obs_data_release(statistics);
-	obs_data_set_obj(settings, "statistics", statistics);
 	stale_settings = {"pan_pos", "tilt_pos", "zoom_pos", "focus_pos"};
+	publishState();
 	ptzDeviceList.add(this);
 }
 
@@ -86,6 +91,7 @@ void PTZDevice::setObjectName(QString name)
 	}
 	if (name == objectName())
 		return;
+	QString prev_name = objectName();
 	QString new_name = name;
 	for (int i = 1;; i++) {
 		PTZDevice *ptz = ptzDeviceList.getDeviceByName(new_name);
@@ -94,7 +100,7 @@ void PTZDevice::setObjectName(QString name)
 		new_name = name + " " + QString::number(i);
 	}
 	QObject::setObjectName(new_name);
-	ptzDeviceList.name_changed(this);
+	ptzDeviceList.name_changed(this, prev_name);
 }
 
 QString PTZDevice::description()
@@ -103,29 +109,15 @@ QString PTZDevice::description()
 }
 
 /**
- * Update state of the device when the frontend scene changes
+ * Update state of the device when the frontend scene changes. The active
+ * source sets are collected once by PTZListModel for all devices.
  */
-void PTZDevice::onSceneChanged()
-{
-	locked = false;
-	live = false;
-	preview = false;
-	// Check if the device's source is in the active program scene
-	// If it is then disable the pan/tilt/zoom controls
-	auto source = obs_get_source_by_name(QT_TO_UTF8(objectName()));
-	if (source) {
-		auto program = obs_frontend_get_current_scene();
-		locked = live = ptz_scene_is_source_active(program, source);
-		obs_source_release(program);
-
-		if (obs_frontend_preview_program_mode_active()) {
-			auto previewScene = obs_frontend_get_current_preview_scene();
-			preview = ptz_scene_is_source_active(previewScene, source);
-			obs_source_release(previewScene);
-		}
-
-		obs_source_release(source);
-	}
+void PTZDevice::onSceneChanged(const PTZActiveSources &program, const PTZActiveSources &previewSources)
+{
+	// If the device's source is in the active program scene then
+	// disable the pan/tilt/zoom controls
+	locked = live = program.contains(objectName());
+	preview = previewSources.contains(objectName());
 }
 
 void PTZDevice::stop()
@@ -144,6 +136,7 @@ void PTZDevice::pantilt(double pan, double tilt)
 	pan_speed = pan;
 	tilt_speed = tilt;
 	pantilt_changed = true;
+	publishMotion();
 	do_update();
 }
 
@@ -154,6 +147,7 @@ void PTZDevice::zoom(double speed)
 		return;
 	zoom_speed = speed;
 	zoom_changed = true;
+	publishMotion();
 	do_update();
 }
 
@@ -164,21 +158,118 @@ void PTZDevice::focus(double speed)
 		return;
 	focus_speed = speed;
 	focus_changed = true;
+	publishMotion();
 	do_update();
 }
 
+void PTZDevice::post(const PTZCommand &cmd)
+{
+	if (QThread::currentThread() == thread()) {
+		execute(cmd);
+		return;
+	}
+	if (overflowed.load(std::memory_order_acquire) || !commands.push(cmd)) {
+		std::lock_guard<std::mutex> guard(overflow_lock);
+		overflow.push_back(cmd);
+		overflowed.store(true, std::memory_order_release);
+	}
+	if (!commands_wake.exchange(true))
+		QMetaObject::invokeMethod(this, &PTZDevice::drainCommands, Qt::QueuedConnection);
+}
+
+void PTZDevice::drainCommands()
+{
+	/* Clear first; a push racing with the drain schedules another one */
+	commands_wake.store(false);
+	PTZCommand cmd, next;
+	bool have = commands.pop(cmd);
+	while (have) {
+		bool more = commands.pop(next);
+		/* Only the latest of back to back speed changes matters */
+		bool superseded = more && next.op == cmd.op &&
+				  (cmd.op == PTZCommand::PanTilt || cmd.op == PTZCommand::Zoom || cmd.op == PTZCommand::Focus);
+		if (!superseded)
+			execute(cmd);
+		cmd = next;
+		have = more;
+	}
+
+	/* Everything in the ring predates the spill, so it runs first */
+	if (!overflowed.load(std::memory_order_acquire))
+		return;
+	std::vector<PTZCommand> spilled;
+	{
+		std::lock_guard<std::mutex> guard(overflow_lock);
+		spilled.swap(overflow);
+		overflowed.store(false, std::memory_order_release);
+	}
+	for (auto &c : spilled)
+		execute(c);
+}
+
+void PTZDevice::execute(const PTZCommand &cmd)
+{
+	switch (cmd.op) {
+	case PTZCommand::Stop:
+		stop();
+		break;
+	case PTZCommand::PanTilt:
+		pantilt(cmd.a, cmd.b);
+		break;
+	case PTZCommand::PanTiltAbs:
+		pantilt_abs(cmd.a, cmd.b);
+		break;
+	case PTZCommand::PanTiltRel:
+		pantilt_rel(cmd.a, cmd.b);
+		break;
+	case PTZCommand::PanTiltHome:
+		pantilt_home();
+		break;
+	case PTZCommand::PanTiltSetHome:
+		pantilt_set_home();
+		break;
+	case PTZCommand::Zoom:
+		zoom(cmd.a);
+		break;
+	case PTZCommand::ZoomAbs:
+		zoom_abs(cmd.a);
+		break;
+	case PTZCommand::Focus:
+		focus(cmd.a);
+		break;
+	case PTZCommand::FocusAbs:
+		focus_abs(cmd.a);
+		break;
+	case PTZCommand::FocusOneTouch:
+		focus_onetouch();
+		break;
+	case PTZCommand::SetAutofocus:
+		set_autofocus(cmd.i != 0);
+		break;
+	case PTZCommand::MemorySet:
+		memory_set(cmd.i);
+		break;
+	case PTZCommand::MemoryRecall:
+		memory_recall(cmd.i);
+		break;
+	case PTZCommand::MemoryReset:
+		memory_reset(cmd.i);
+		break;
+	}
+}
+
 void PTZDevice::move(calldata_t *cd)
 {
 	double p = 0, t = 0, z = 0, f = 0;
 
 	if (calldata_get_float(cd, "pan", &p) + calldata_get_float(cd, "tilt", &t))
-		QMetaObject::invokeMethod(this, "pantilt", Q_ARG(double, p), Q_ARG(double, t));
+		post({PTZCommand::PanTilt, p, t});
 
 	if (calldata_get_float(cd, "zoom", &z))
-		QMetaObject::invokeMethod(this, "zoom", Q_ARG(double, z));
+		post({PTZCommand::Zoom, z});
 
 	if (calldata_get_float(cd, "focus", &f))
-		QMetaObject::invokeMethod(this, "focus", Q_ARG(double, f));
+		post({PTZCommand::Focus, f});
 }
 
 void PTZDevice::move_abs(calldata_t *cd)
@@ -186,13 +277,13 @@ void PTZDevice::move_abs(calldata_t *cd)
 	double p = 0, t = 0, z = 0, f = 0;
 
 	if (calldata_get_float(cd, "pan", &p) + calldata_get_float(cd, "tilt", &t))
-		QMetaObject::invokeMethod(this, "pantilt_abs", Q_ARG(double, p), Q_ARG(double, t));
+		post({PTZCommand::PanTiltAbs, p, t});
 
 	if (calldata_get_float(cd, "zoom", &z))
-		QMetaObject::invokeMethod(this, "zoom_abs", Q_ARG(double, z));
+		post({PTZCommand::ZoomAbs, z});
 
 	if (calldata_get_float(cd, "focus", &f))
-		QMetaObject::invokeMethod(this, "focus_abs", Q_ARG(double, f));
+		post({PTZCommand::FocusAbs, f});
 }
 
 void PTZDevice::move_rel(calldata_t *cd)
@@ -200,52 +291,57 @@ void PTZDevice::move_rel(calldata_t *cd)
 	double p = 0, t = 0;
 
 	if (calldata_get_float(cd, "pan", &p) + calldata_get_float(cd, "tilt", &t))
-		QMetaObject::invokeMethod(this, "pantilt_rel", Q_ARG(double, p), Q_ARG(double, t));
+		post({PTZCommand::PanTiltRel, p, t});
 }
 
 void PTZDevice::get(calldata_t *cd) const
 {
-	if (QThread::currentThread() != thread()) {
-		ptz_log(LOG_ERROR, "PTZDevice::get(calldata) called from wrong thread; ignored");
-		return;
-	}
+	auto state = snapshot();
 	QString arg = calldata_string(cd, "property");
-	if (arg == "power_on")
-		calldata_set_bool(cd, "power_on", obs_data_get_bool(settings, "power_on"));
-	else if (arg == "focus_af_enabled")
-		calldata_set_bool(cd, "focus_af_enabled", obs_data_get_bool(settings, "focus_af_enabled"));
-	return;
+	if (arg == "connected") {
+		calldata_set_bool(cd, "connected", state->connected);
+	} else if (arg == "power_on" || arg == "focus_af_enabled") {
+		calldata_set_bool(cd, QT_TO_UTF8(arg), obs_data_get_bool(state->settings, QT_TO_UTF8(arg)));
+	} else if (arg == "pan_pos" || arg == "tilt_pos" || arg == "zoom_pos" || arg == "focus_pos") {
+		OBSDataItemAutoRelease item = obs_data_item_byname(state->settings, QT_TO_UTF8(arg));
+		if (!item || !obs_data_item_has_user_value(item))
+			return;
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_DOUBLE)
+			calldata_set_float(cd, QT_TO_UTF8(arg), obs_data_item_get_double(item));
+		else
+			calldata_set_int(cd, QT_TO_UTF8(arg), obs_data_item_get_int(item));
+	}
 }
 
 void PTZDevice::set(calldata_t *cd)
 {
 	bool enable;
 	if (calldata_get_bool(cd, "focus_af_enabled", &enable))
-		QMetaObject::invokeMethod(this, "set_autofocus", Q_ARG(bool, enable));
+		post({PTZCommand::SetAutofocus, 0, 0, enable});
 	bool trigger;
 	if (calldata_get_bool(cd, "focus_onetouch_trigger", &trigger) && trigger)
-		QMetaObject::invokeMethod(this, &PTZDevice::focus_onetouch);
+		post({PTZCommand::FocusOneTouch});
 }
 
 void PTZDevice::preset_save(calldata_t *cd)
 {
 	long long id;
 	if (calldata_get_int(cd, "preset_id", &id))
-		QMetaObject::invokeMethod(this, "memory_set", Q_ARG(int, id));
+		post({PTZCommand::MemorySet, 0, 0, (int)id});
 }
 
 void PTZDevice::preset_recall(calldata_t *cd)
 {
 	long long id;
 	if (calldata_get_int(cd, "preset_id", &id))
-		QMetaObject::invokeMethod(this, "memory_recall", Q_ARG(int, id));
+		post({PTZCommand::MemoryRecall, 0, 0, (int)id});
 }
 
 void PTZDevice::preset_clear(calldata_t *cd)
 {
 	long long id;
 	if (calldata_get_int(cd, "preset_id", &id))
-		QMetaObject::invokeMethod(this, "memory_reset", Q_ARG(int, id));
+		post({PTZCommand::MemoryReset, 0, 0, (int)id});
 }
 
 void PTZDevice::getDefaults(OBSData config) const
@@ -269,16 +365,12 @@ void PTZDevice::update(OBSData config)
 	m_maxPresets = std::clamp<size_t>(obs_data_get_int(config, "preset_max"), 1, 128);
 	/* Update the list of preset names */
 	OBSDataArrayAutoRelease preset_array = obs_data_get_array(config, "presets");
-	m_presets.clear();
-	m_presetsDisplayOrder.clear();
-	for (size_t i = 0; i < obs_data_array_count(preset_array); i++) {
-		OBSDataAutoRelease item = obs_data_array_item(preset_array, i);
-		auto id = obs_data_get_int(item, "id");
-		if (m_presetsDisplayOrder.contains(id))
-			continue;
-		QVariantMap preset = OBSDataToVariantMap(item.Get());
-		m_presets[id] = preset;
-		sanitizePreset(id);
+	m_presets.load(preset_array);
+	for (int row = 0; row < m_presets.count(); row++) {
+		const PTZPreset &p = m_presets.at(row);
+		QString name = sanitizePresetName(p.id, p.name);
+		if (name != p.name)
+			m_presets.setName(p.id, name);
 	}
 
 	setObjectName(obs_data_get_string(config, "name"));
@@ -306,11 +398,7 @@ void PTZDevice::save(OBSData config) const
 	obs_data_set_int(config, "preset_max", m_maxPresets);
 
 	OBSDataArrayAutoRelease preset_array = obs_data_array_create();
-	for (auto id : m_presetsDisplayOrder) {
-		OBSDataAutoRelease data = variantMapToOBSData(m_presets[id]);
-		obs_data_set_int(data, "id", id);
-		obs_data_array_push_back(preset_array, data);
-	}
+	m_presets.save(preset_array);
 	obs_data_set_array(config, "presets", preset_array);
 }
 
@@ -319,12 +407,6 @@ obs_properties_t *PTZDevice::get_obs_properties()
 	obs_properties_t *rtn_props = obs_properties_create();
 
 	/* Combo box list for associated OBS source */
-	auto src_cb = [](void *data, obs_source_t *src) {
-		auto srcnames = static_cast<QStringList *>(data);
-		if (obs_source_get_type(src) != OBS_SOURCE_TYPE_SCENE)
-			srcnames->append(obs_source_get_name(src));
-		return true;
-	};
 	auto srcs_prop = obs_properties_add_list(rtn_props, "name", obs_module_text("PTZ.Source"), OBS_COMBO_TYPE_LIST,
 						 OBS_COMBO_FORMAT_STRING);
 	obs_property_list_add_string(srcs_prop, obs_module_text("PTZ.Device.NoSource"), "");
@@ -333,11 +415,7 @@ obs_properties_t *PTZDevice::get_obs_properties()
 	if (src)
 		obs_property_list_add_string(srcs_prop, QT_TO_UTF8(objectName()), QT_TO_UTF8(objectName()));
 	/* Add all sources not assigned to a camera */
-	QStringList srcnames;
-	obs_enum_sources(src_cb, &srcnames);
-	for (auto n : ptzDeviceList.getDeviceNames())
-		srcnames.removeAll(n);
-	for (auto n : srcnames)
+	for (auto &n : ptzSourceIndex.unassignedSources())
 		obs_property_list_add_string(srcs_prop, QT_TO_UTF8(n), QT_TO_UTF8(n));
 
 	obs_properties_t *config = obs_properties_create();
@@ -385,11 +463,13 @@ void ptz_devices_set_config(obs_data_array_t *devices)
 		blog(LOG_INFO, "No PTZ device configuration found");
 		return;
 	}
+	ptzDeviceList.beginBulkLoad();
 	for (size_t i = 0; i < obs_data_array_count(devices); i++) {
 		OBSData ptzcfg = obs_data_array_item(devices, i);
 		obs_data_release(ptzcfg);
 		ptzDeviceList.make_device(ptzcfg);
 	}
+	ptzDeviceList.endBulkLoad();
 }
 
 static proc_handler_t *ptz_ph = NULL;
@@ -401,6 +481,8 @@ proc_handler_t *ptz_get_proc_handler()
 
 void ptz_load_devices()
 {
+	ptzSourceIndex.load();
+
 	/* Register the proc handlers for issuing PTZ commands */
 	ptz_ph = proc_handler_create();
 	if (!ptz_ph)
@@ -436,36 +518,49 @@ void ptz_load_devices()
 
 void ptz_unload_devices(void)
 {
+	ptzSourceIndex.unload();
 	proc_handler_destroy(ptz_ph);
 	ptz_ph = nullptr;
+#if defined(ENABLE_ONVIF)
+	OnvifTransport::release();
+#endif
 }
 
-void PTZDevice::sanitizePreset(size_t id)
+/* Names that are empty or the same as the default label aren't stored */
+QString PTZDevice::sanitizePresetName(size_t id, const QString &name) const
 {
-	if (!m_presets.contains(id))
-		return;
-	if (!m_presetsDisplayOrder.contains(id))
-		m_presetsDisplayOrder.append(id);
-	QVariantMap &preset = m_presets[id];
-	QString name = preset["name"].toString();
-	if (name == "" || name == QString(obs_module_text("PTZ.PresetNum")).arg(id))
-		preset.remove("name");
+	if (name == QString(obs_module_text("PTZ.PresetNum")).arg(id))
+		return QString();
+	return name;
+}
+
+QString PTZDevice::presetName(size_t id) const
+{
+	auto p = m_presets.find(id);
+	return p ? p->name : QString();
+}
+
+QString PTZDevice::presetToken(size_t id) const
+{
+	auto p = m_presets.find(id);
+	return p ? p->token : QString();
 }
 
 void PTZDevice::setPresetName(size_t id, QString name)
 {
-	if (!m_presets.contains(id))
-		return;
-	QVariantMap &preset = m_presets[id];
-	preset["name"] = name;
-	sanitizePreset(id);
+	m_presets.setName(id, sanitizePresetName(id, name));
+}
+
+void PTZDevice::setPresetToken(size_t id, QString token)
+{
+	m_presets.setToken(id, token);
 }
 
 /* Insert a new preset and return the ID */
 int PTZDevice::newPreset(int row)
 {
-	if ((row < 0) || (row > m_presetsDisplayOrder.size()))
-		row = m_presetsDisplayOrder.size();
+	if ((row < 0) || (row > m_presets.count()))
+		row = m_presets.count();
 	int id = 0;
 	while (m_presets.contains(id))
 		id++;
@@ -473,10 +568,9 @@ int PTZDevice::newPreset(int row)
 		return -1;
 
 	ptzDeviceList.presetBeginInsert(this, row);
-	QVariantMap map;
-	map["id"] = (uint)id;
-	m_presets[id] = map;
-	m_presetsDisplayOrder.insert(row, id);
+	PTZPreset preset;
+	preset.id = id;
+	m_presets.insert(row, preset);
 	ptzDeviceList.presetEndInsert(this);
 
 	return id;
@@ -485,8 +579,7 @@ int PTZDevice::newPreset(int row)
 void PTZDevice::removePresetAtDisplayRow(int row)
 {
 	ptzDeviceList.presetBeginRemove(this, row);
-	m_presets.remove(m_presetsDisplayOrder[row]);
-	m_presetsDisplayOrder.removeAt(row);
+	m_presets.removeAt(row);
 	ptzDeviceList.presetEndRemove(this);
 }
 
@@ -496,7 +589,7 @@ void PTZDevice::movePreset(int srcRow, int destRow)
 		return;
 	if (srcRow < destRow)
 		destRow--;
-	m_presetsDisplayOrder.move(srcRow, destRow);
+	m_presets.move(srcRow, destRow);
 	ptzDeviceList.presetEndMove(this);
 }
 
@@ -504,45 +597,107 @@ int PTZDevice::presetAtDisplayRow(int row) const
 {
 	if (row < 0 || row >= presetCount())
 		return -1;
-	return (int)m_presetsDisplayOrder[row];
+	return (int)m_presets.at(row).id;
 }
 
-QVariant PTZDevice::presetProperty(size_t id, QString key) const
+static std::vector<std::string> &statisticNames()
 {
-	/* Safe to dereference unconditionally here. Both levels will return
-	 * default empty values without segfaulting */
-	return m_presets[id][key];
+	static std::vector<std::string> names;
+	return names;
 }
 
-bool PTZDevice::updatePreset(size_t id, const QVariantMap &map)
+int PTZStatistics::registerCounter(const char *name)
 {
-	if (!m_presets.contains(id))
-		return false;
-	m_presets[id].insert(map);
-	return true;
+	auto &names = statisticNames();
+	auto it = std::find(names.begin(), names.end(), name);
+	if (it != names.end())
+		return (int)(it - names.begin());
+	if (names.size() >= maxCounters) {
+		blog(LOG_ERROR, "[obs-ptz] too many statistics counters; '%s' not counted", name);
+		return noCounter;
+	}
+	names.push_back(name);
+	return (int)names.size() - 1;
 }
 
-int PTZDevice::findPreset(QString key, QVariant value) const
+void PTZStatistics::exportTo(obs_data_t *data) const
 {
-	/* Search for the matching key/value pair in all presets.
-	 * This is an O(N) operation */
-	auto end = m_presets.cend();
-	for (auto i = m_presets.cbegin(); i != end; i++) {
-		if (i.value()[key] == value)
-			return (int)i.key();
+	auto &names = statisticNames();
+	for (size_t i = 0; i < names.size(); i++) {
+		uint64_t count = counters[i].load(std::memory_order_relaxed);
+		/* The registry is shared by all drivers; leave out what this
+		 * device never counted */
+		if (count)
+			obs_data_set_int(data, names[i].c_str(), count);
 	}
-	return -1;
 }
 
-void PTZDevice::incrementStatistic(const char *name)
+/* Exported at most a few times a second; callers within that window get the
+ * previous export. */
+OBSData PTZDevice::getStatistics()
 {
-	obs_data_set_int(statistics, name, obs_data_get_int(statistics, name) + 1);
+	uint64_t now = os_gettime_ns();
+	if (!statisticsData || now - statisticsExportedAt > 250000000) {
+		statisticsData = obs_data_create();
+		obs_data_release(statisticsData);
+		statistics.exportTo(statisticsData);
+		statisticsExportedAt = now;
+	}
+	return statisticsData;
 }
 
 void PTZDevice::setConnected(bool _connected)
 {
 	bool was_connected = connected;
 	connected = _connected;
-	if (was_connected != connected)
+	if (was_connected != connected) {
+		publishState();
 		emit connectionStatusChanged(connected);
+	}
+}
+
+/* Called on the device's thread whenever connected or settings change */
+void PTZDevice::publishState()
+{
+	auto next = std::make_shared<PTZStateSnapshot>();
+	next->connected = connected;
+	next->settings = obs_data_create();
+	obs_data_release(next->settings);
+	obs_data_apply(next->settings, settings);
+	std::atomic_store(&state, std::shared_ptr<const PTZStateSnapshot>(std::move(next)));
+}
+
+static bool settingDiffers(obs_data_t *settings, obs_data_item_t *item)
+{
+	const char *name = obs_data_item_get_name(item);
+	if (!obs_data_has_user_value(settings, name))
+		return true;
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT)
+			return obs_data_item_get_int(item) != obs_data_get_int(settings, name);
+		return obs_data_item_get_double(item) != obs_data_get_double(settings, name);
+	case OBS_DATA_BOOLEAN:
+		return obs_data_item_get_bool(item) != obs_data_get_bool(settings, name);
+	case OBS_DATA_STRING:
+		return strcmp(obs_data_item_get_string(item), obs_data_get_string(settings, name)) != 0;
+	default:
+		return true;
+	}
+}
+
+/* Merge changes into the settings and republish the snapshot, but only if a
+ * value actually changed. Position polls mostly report what is already
+ * known, so this keeps them from copying the settings every time. */
+bool PTZDevice::applySettings(obs_data_t *changes)
+{
+	obs_data_item_t *item = obs_data_first(changes);
+	while (item && !settingDiffers(settings, item))
+		obs_data_item_next(&item);
+	if (!item)
+		return false;
+	obs_data_item_release(&item);
+	obs_data_apply(settings, changes);
+	publishState();
+	return true;
 }
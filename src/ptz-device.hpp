@@ -10,11 +10,17 @@
 #include <QList>
 #include <QMap>
 #include <QVariantMap>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <obs.hpp>
 #include <obs-frontend-api.h>
 #include <qt-wrappers.hpp>
 #include <util/platform.h>
 #include "ptz.h"
+#include "ptz-presets.hpp"
+#include "ptz-sources.hpp"
 
 #define ptz_log(level, format, ...) \
 	blog(level, "[%s/%.12s] " format, this->type.c_str(), QT_TO_UTF8(this->objectName()), ##__VA_ARGS__)
@@ -24,12 +30,175 @@
 	if (this->protocol_trace)    \
 	ptz_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+/* Continuous motion speeds, as last commanded through pantilt()/zoom()/focus() */
+struct PTZMotion {
+	double pan = 0;
+	double tilt = 0;
+	double zoom = 0;
+	double focus = 0;
+};
+
+/*
+ * Single writer seqlock around a PTZMotion. The device's own thread writes,
+ * and any other thread (the OBS tick, a driver worker) can read a consistent
+ * pan/tilt/zoom/focus tuple without taking a lock. A reader that overlaps a
+ * write just retries.
+ */
+class PTZMotionState {
+	std::atomic<uint32_t> seq{0};
+	std::atomic<double> pan{0}, tilt{0}, zoom{0}, focus{0};
+
+public:
+	void publish(const PTZMotion &m)
+	{
+		uint32_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		pan.store(m.pan, std::memory_order_relaxed);
+		tilt.store(m.tilt, std::memory_order_relaxed);
+		zoom.store(m.zoom, std::memory_order_relaxed);
+		focus.store(m.focus, std::memory_order_relaxed);
+		seq.store(s + 2, std::memory_order_release);
+	}
+	PTZMotion read() const
+	{
+		PTZMotion m;
+		uint32_t s1, s2;
+		do {
+			s1 = seq.load(std::memory_order_acquire);
+			m.pan = pan.load(std::memory_order_relaxed);
+			m.tilt = tilt.load(std::memory_order_relaxed);
+			m.zoom = zoom.load(std::memory_order_relaxed);
+			m.focus = focus.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s2 = seq.load(std::memory_order_relaxed);
+		} while ((s1 & 1) || s1 != s2);
+		return m;
+	}
+};
+
+/*
+ * Fixed block of per-device event counters. Counter names live in a single
+ * plugin-wide registry; each driver registers its names once, normally when
+ * its file's statics are initialised, and then increments by index, which is
+ * one relaxed atomic add. The counters are only turned into OBSData when
+ * somebody asks for them, and only the ones a device has actually counted
+ * show up there. Names registered past maxCounters get noCounter, which
+ * increment() ignores.
+ */
+class PTZStatistics {
+public:
+	static const int maxCounters = 32;
+	static const int noCounter = -1;
+	static int registerCounter(const char *name);
+	void increment(int id)
+	{
+		if (id >= 0 && id < maxCounters)
+			counters[id].fetch_add(1, std::memory_order_relaxed);
+	}
+	void exportTo(obs_data_t *data) const;
+
+private:
+	std::atomic<uint64_t> counters[maxCounters] = {};
+};
+
+/* A control request queued for the device's thread by PTZCommandRing */
+struct PTZCommand {
+	enum Op : uint8_t {
+		Stop,
+		PanTilt,
+		PanTiltAbs,
+		PanTiltRel,
+		PanTiltHome,
+		PanTiltSetHome,
+		Zoom,
+		ZoomAbs,
+		Focus,
+		FocusAbs,
+		FocusOneTouch,
+		SetAutofocus,
+		MemorySet,
+		MemoryRecall,
+		MemoryReset,
+	};
+	Op op = Stop;
+	double a = 0;
+	double b = 0;
+	int i = 0;
+};
+
+/*
+ * Bounded multi-producer, single-consumer ring of PTZCommands. Any thread may
+ * push(); only the device's thread may pop(). Each slot carries a sequence
+ * number telling producers and the consumer whose turn it is, so neither side
+ * ever blocks. push() fails when the ring is full.
+ */
+class PTZCommandRing {
+	static const size_t size = 64;
+	struct Slot {
+		std::atomic<size_t> seq;
+		PTZCommand cmd;
+	};
+	Slot slots[size];
+	std::atomic<size_t> head{0};
+	size_t tail = 0;
+
+public:
+	PTZCommandRing()
+	{
+		for (size_t i = 0; i < size; i++)
+			slots[i].seq.store(i, std::memory_order_relaxed);
+	}
+	bool push(const PTZCommand &cmd)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		for (;;) {
+			Slot &slot = slots[pos % size];
+			intptr_t diff = (intptr_t)slot.seq.load(std::memory_order_acquire) - (intptr_t)pos;
+			if (diff == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					slot.cmd = cmd;
+					slot.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	bool pop(PTZCommand &cmd)
+	{
+		Slot &slot = slots[tail % size];
+		if (slot.seq.load(std::memory_order_acquire) != tail + 1)
+			return false;
+		cmd = slot.cmd;
+		slot.seq.store(tail + size, std::memory_order_release);
+		tail++;
+		return true;
+	}
+};
+
+/*
+ * Read-only copy of the device state for readers on other threads. A new
+ * snapshot is built and swapped in on every change; nothing in a published
+ * snapshot is ever modified, so readers only need to hold a reference.
+ */
+struct PTZStateSnapshot {
+	bool connected = false;
+	/* Copy of the device settings (power, focus mode, positions, ...) */
+	OBSData settings;
+};
+
 class PTZDevice : public QObject {
 	Q_OBJECT
 	friend class PTZListModel;
 
 protected:
 	uint32_t id = 0;
+	/* Row in PTZListModel, maintained by the model; -1 when not listed */
+	int modelRow = -1;
 	std::string type;
 	bool connected = false;
 	bool locked = false;
@@ -49,26 +218,49 @@ protected:
 	double focus_speed_max = 1.0;
 	bool focus_invert = false;
 	bool focus_changed = false;
+	PTZMotionState motion_state;
+	void publishMotion() { motion_state.publish({pan_speed, tilt_speed, zoom_speed, focus_speed}); }
 
 protected:
 	/* Collection of all presets, keyed by unique integer id.
 	 * On cameras that use preset numbers, the id is mapped 1:1 with the
 	 * preset number.  */
 	size_t m_maxPresets = 16;
-	QMap<size_t, QVariantMap> m_presets;
-	QList<size_t> m_presetsDisplayOrder;
-	void sanitizePreset(size_t id);
+	PTZPresetStore m_presets;
+	QString sanitizePresetName(size_t id, const QString &name) const;
 	void setConnected(bool connected);
 	obs_properties_t *props;
 	OBSData settings;
-	OBSData statistics;
+	PTZStatistics statistics;
+	OBSData statisticsData;
+	uint64_t statisticsExportedAt = 0;
 	QSet<QString> stale_settings;
-	void incrementStatistic(const char *name);
+	void incrementStatistic(int id) { statistics.increment(id); }
 
 	// Each PTZ device has a proc handler so methods can be called
 	// from other plugins
 	proc_handler_t *handler = nullptr;
 
+	/* Proc handler calls from other threads are queued here and run in
+	 * a batch on the device's thread; commands_wake is set while a drain
+	 * is already scheduled so a burst only posts one Qt event. */
+	PTZCommandRing commands;
+	std::atomic<bool> commands_wake{false};
+	/* When the ring is full, commands spill over here in order. Once
+	 * anything has spilled, later commands follow it until the next
+	 * drain has run them, so nothing overtakes an earlier command. */
+	std::mutex overflow_lock;
+	std::vector<PTZCommand> overflow;
+	std::atomic<bool> overflowed{false};
+	void post(const PTZCommand &cmd);
+	void execute(const PTZCommand &cmd);
+	void drainCommands();
+
+	std::shared_ptr<const PTZStateSnapshot> state;
+	void publishState();
+	bool applySettings(obs_data_t *changes);
+	std::shared_ptr<const PTZStateSnapshot> snapshot() const { return std::atomic_load(&state); }
+
 signals:
 	void settingsChanged(OBSData settings);
 	void connectionStatusChanged(bool connected);
@@ -82,20 +274,20 @@ public:
 	virtual QString description();
 	bool isLive() const { return live; }
 	bool isPreview() const { return preview; }
-	void onSceneChanged();
+	void onSceneChanged(const PTZActiveSources &program, const PTZActiveSources &preview);
 
 	size_t maxPresets() const { return m_maxPresets; }
-	int presetCount() const { return m_presetsDisplayOrder.size(); }
+	int presetCount() const { return m_presets.count(); }
 	int newPreset(int row = -1);
 	void removePresetAtDisplayRow(int row);
 	void movePreset(int srcRow, int destRow);
 	int presetAtDisplayRow(int row) const;
-	QString presetName(size_t id) const { return m_presets[id]["name"].toString(); }
-	QString presetToken(size_t id) const { return m_presets[id]["token"].toString(); }
+	QString presetName(size_t id) const;
+	QString presetToken(size_t id) const;
 	void setPresetName(size_t id, QString name);
-	QVariant presetProperty(size_t id, QString key) const;
-	bool updatePreset(size_t id, const QVariantMap &map);
-	int findPreset(QString key, QVariant value) const;
+	void setPresetToken(size_t id, QString token);
+	int findPresetByToken(const QString &token) const { return m_presets.findByToken(token); }
+	int findPresetByName(const QString &name) const { return m_presets.findByName(name); }
 
 	/**
 	 * do_update() method is to be implemented by each driver as the way
@@ -163,9 +355,9 @@ protected slots:
 	virtual void memory_recall(int i) { Q_UNUSED(i); }
 	virtual void memory_reset(int i) { Q_UNUSED(i); }
 
-	void stop(calldata_t *) { QMetaObject::invokeMethod(this, "stop"); }
-	void pantilt_home(calldata_t *) { QMetaObject::invokeMethod(this, "pantilt_home"); }
-	void pantilt_set_home(calldata_t *) { QMetaObject::invokeMethod(this, "pantilt_set_home"); }
+	void stop(calldata_t *) { post({PTZCommand::Stop}); }
+	void pantilt_home(calldata_t *) { post({PTZCommand::PanTiltHome}); }
+	void pantilt_set_home(calldata_t *) { post({PTZCommand::PanTiltSetHome}); }
 	void move(calldata_t *cd);
 	void move_abs(calldata_t *cd);
 	void move_rel(calldata_t *cd);
@@ -182,6 +374,9 @@ public:
 	bool pantiltChanged() const { return pantilt_changed; }
 	bool zoomChanged() const { return zoom_changed; }
 	bool focusChanged() const { return focus_changed; }
+	/* Safe to call from any thread */
+	PTZMotion motion() const { return motion_state.read(); }
+	OBSData getStatistics();
 
 	/* Device configuration methods
 	 * These match the pattern used by sources in OBS studio with the following methods:
@@ -0,0 +1,130 @@
+/* Pan Tilt Zoom network discovery
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListWidget>
+#include <QPushButton>
+#include <obs-module.h>
+#include "ptz-discovery.hpp"
+#include "ptz-list-model.hpp"
+
+PTZDiscoveryDialog::PTZDiscoveryDialog(PTZDiscovery *discovery_, const QString &title, QWidget *parent)
+	: QDialog(parent),
+	  discovery(discovery_)
+{
+	setWindowTitle(title);
+	setAttribute(Qt::WA_DeleteOnClose);
+	discovery->setParent(this);
+
+	status = new QLabel(this);
+	list = new QListWidget(this);
+	list->setSelectionMode(QAbstractItemView::ExtendedSelection);
+	searchButton = new QPushButton(obs_module_text("PTZ.Discovery.SearchAgain"), this);
+	addButton = new QPushButton(obs_module_text("PTZ.Discovery.Add"), this);
+	addButton->setDefault(true);
+	addButton->setEnabled(false);
+	QPushButton *closeButton = new QPushButton(obs_module_text("PTZ.Discovery.Close"), this);
+
+	QHBoxLayout *buttons = new QHBoxLayout();
+	buttons->addWidget(searchButton);
+	buttons->addStretch();
+	buttons->addWidget(addButton);
+	buttons->addWidget(closeButton);
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	layout->addWidget(status);
+	layout->addWidget(list);
+	layout->addLayout(buttons);
+	resize(480, 320);
+
+	connect(discovery, &PTZDiscovery::found, this, &PTZDiscoveryDialog::deviceFound);
+	connect(discovery, &PTZDiscovery::finished, this, &PTZDiscoveryDialog::searchFinished);
+	connect(searchButton, &QPushButton::clicked, this, &PTZDiscoveryDialog::search);
+	connect(addButton, &QPushButton::clicked, this, &PTZDiscoveryDialog::addSelected);
+	connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+	connect(list, &QListWidget::itemSelectionChanged, this,
+		[this]() { addButton->setEnabled(!list->selectedItems().isEmpty()); });
+	connect(list, &QListWidget::itemDoubleClicked, this, &PTZDiscoveryDialog::addSelected);
+
+	search();
+}
+
+PTZDiscoveryDialog::~PTZDiscoveryDialog()
+{
+	discovery->stop();
+}
+
+void PTZDiscoveryDialog::search()
+{
+	list->clear();
+	items.clear();
+	configs.clear();
+	configured.clear();
+	OBSDataArrayAutoRelease devices = obs_data_array_create();
+	ptzDeviceList.save(devices.Get());
+	for (size_t i = 0; i < obs_data_array_count(devices); i++) {
+		OBSDataAutoRelease cfg = obs_data_array_item(devices, i);
+		configured.insert(configKey(cfg));
+	}
+
+	searchButton->setEnabled(false);
+	status->setText(obs_module_text("PTZ.Discovery.Searching"));
+	discovery->start();
+}
+
+QString PTZDiscoveryDialog::configKey(obs_data_t *config)
+{
+	return QString("%1:%2:%3")
+		.arg(obs_data_get_string(config, "type"), obs_data_get_string(config, "host"))
+		.arg(obs_data_get_int(config, "port"));
+}
+
+bool PTZDiscoveryDialog::alreadyConfigured(OBSData config) const
+{
+	return configured.contains(configKey(config));
+}
+
+void PTZDiscoveryDialog::deviceFound(const QString &key, const QString &label, OBSData config)
+{
+	QListWidgetItem *item = items.value(key);
+	if (!item) {
+		item = new QListWidgetItem(list);
+		items.insert(key, item);
+		item->setData(Qt::UserRole, key);
+	}
+	configs.insert(key, config);
+
+	if (alreadyConfigured(config)) {
+		item->setText(QString("%1 %2").arg(label, obs_module_text("PTZ.Discovery.AlreadyAdded")));
+		item->setFlags(item->flags() & ~(Qt::ItemIsSelectable | Qt::ItemIsEnabled));
+	} else {
+		item->setText(label);
+	}
+	status->setText(QString(obs_module_text("PTZ.Discovery.Found")).arg(items.size()));
+}
+
+void PTZDiscoveryDialog::searchFinished()
+{
+	searchButton->setEnabled(true);
+	if (items.isEmpty())
+		status->setText(obs_module_text("PTZ.Discovery.NoneFound"));
+}
+
+void PTZDiscoveryDialog::addSelected()
+{
+	for (QListWidgetItem *item : list->selectedItems()) {
+		QString key = item->data(Qt::UserRole).toString();
+		OBSData config = configs.value(key);
+		if (!config || alreadyConfigured(config))
+			continue;
+		ptzDeviceList.make_device(config);
+		configured.insert(configKey(config));
+		item->setText(QString("%1 %2").arg(item->text(), obs_module_text("PTZ.Discovery.AlreadyAdded")));
+		item->setFlags(item->flags() & ~(Qt::ItemIsSelectable | Qt::ItemIsEnabled));
+	}
+}
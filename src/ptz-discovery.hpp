@@ -0,0 +1,69 @@
+/* Pan Tilt Zoom network discovery
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QObject>
+#include <QDialog>
+#include <QHash>
+#include <QSet>
+#include <obs.hpp>
+
+class QLabel;
+class QListWidget;
+class QListWidgetItem;
+class QPushButton;
+
+/*
+ * Base class for protocol specific network scanners. A scanner reports every
+ * camera it finds with found(); key identifies the camera (endpoint UUID, MAC
+ * address...) and a camera may be reported again under the same key when more
+ * details arrive. config is ready to be handed to PTZListModel::make_device().
+ */
+class PTZDiscovery : public QObject {
+	Q_OBJECT
+
+public:
+	virtual void start() = 0;
+	virtual void stop() = 0;
+
+signals:
+	void found(const QString &key, const QString &label, OBSData config);
+	void finished();
+};
+
+/*
+ * Dialog that runs a PTZDiscovery and lets the user add the cameras it finds.
+ * Cameras that already have a device with the same type, host and port are
+ * listed but can't be added twice.
+ */
+class PTZDiscoveryDialog : public QDialog {
+	Q_OBJECT
+
+private:
+	PTZDiscovery *discovery;
+	QLabel *status;
+	QListWidget *list;
+	QPushButton *addButton;
+	QPushButton *searchButton;
+	QHash<QString, QListWidgetItem *> items;
+	QHash<QString, OBSData> configs;
+	/* type:host:port of every existing device, taken when a scan starts */
+	QSet<QString> configured;
+
+	static QString configKey(obs_data_t *config);
+	bool alreadyConfigured(OBSData config) const;
+
+private slots:
+	void search();
+	void deviceFound(const QString &key, const QString &label, OBSData config);
+	void searchFinished();
+	void addSelected();
+
+public:
+	PTZDiscoveryDialog(PTZDiscovery *discovery, const QString &title, QWidget *parent = nullptr);
+	~PTZDiscoveryDialog();
+};
@@ -5,9 +5,14 @@
  * SPDX-License-Identifier: GPLv2
  */
 
+#include <algorithm>
 #include <obs.hpp>
+#include <obs-frontend-api.h>
+#include <QTimer>
+#include <QVariantMap>
 #include "ptz-list-model.hpp"
 #include "ptz-device.hpp"
+#include "ptz-sources.hpp"
 #include "ptz-visca-udp.hpp"
 #include "ptz-visca-tcp.hpp"
 #include "ptz-onvif.hpp"
@@ -68,11 +73,8 @@ QModelIndex PTZListModel::parent(const QModelIndex &child) const
 {
 	/* If the internal pointer is set, then this is a preset index */
 	auto ptz = static_cast<PTZDevice *>(child.internalPointer());
-	if (ptz) {
-		int row = devices.indexOf(ptz);
-		if (row >= 0)
-			return createIndex(row, 0);
-	}
+	if (ptz && ptz->modelRow >= 0)
+		return createIndex(ptz->modelRow, 0);
 
 	return QModelIndex();
 }
@@ -206,6 +208,23 @@ QVariant PTZListModel::data(const QModelIndex &index, int role) const
 	if (role == PTZListModel::SupportsSetHomeRole)
 		return ptz->supportsSetHome();
 
+	if (role == PTZListModel::IsAutofocusRole)
+		return obs_data_get_bool(ptz->snapshot()->settings, "focus_af_enabled");
+
+	if (role == PTZListModel::PositionRole) {
+		auto state = ptz->snapshot();
+		QVariantMap pos;
+		for (auto key : {"pan_pos", "tilt_pos", "zoom_pos", "focus_pos"}) {
+			OBSDataItemAutoRelease item = obs_data_item_byname(state->settings, key);
+			if (item && obs_data_item_has_user_value(item))
+				pos[key] = obs_data_item_get_double(item);
+		}
+		return pos;
+	}
+
+	if (role == PTZListModel::SettingsRole)
+		return QString(obs_data_get_json(ptz->snapshot()->settings));
+
 	return QVariant();
 }
 
@@ -239,23 +258,69 @@ bool PTZListModel::setData(const QModelIndex &index, const QVariant &value, int
 	return false;
 }
 
-void PTZListModel::do_reset()
+/*
+ * Bulk loading - devices added between beginBulkLoad() and endBulkLoad() are
+ * announced to views with a single model reset instead of a row insert each.
+ * Calls may nest; only the outermost pair notifies.
+ */
+void PTZListModel::beginBulkLoad()
+{
+	if (bulkLoadDepth++ == 0)
+		beginResetModel();
+}
+
+void PTZListModel::endBulkLoad()
 {
-	beginResetModel();
-	endResetModel();
+	if (bulkLoadDepth > 0 && --bulkLoadDepth == 0)
+		endResetModel();
 }
 
-void PTZListModel::name_changed(PTZDevice *ptz)
+void PTZListModel::name_changed(PTZDevice *ptz, const QString &prev_name)
 {
+	if (ptz->modelRow < 0)
+		return;
+	if (devicesByName.value(prev_name) == ptz) {
+		devicesByName.remove(prev_name);
+		ptzSourceIndex.unassign(prev_name);
+	}
+	devicesByName.insert(ptz->objectName(), ptz);
+	ptzSourceIndex.assign(ptz->objectName());
 	auto index = indexFromDeviceId(ptz->id);
-	if (index.isValid())
-		emit dataChanged(index, index);
+	if (index.isValid() && !bulkLoadDepth)
+		emit dataChanged(index, index, {Qt::DisplayRole, Qt::EditRole});
 }
 
+/* Walk the program and preview scenes once and update every device from that */
 void PTZListModel::onSceneChanged()
 {
-	for (PTZDevice *ptz : devices)
-		ptz->onSceneChanged();
+	OBSSourceAutoRelease program = obs_frontend_get_current_scene();
+	programSources.collect(program);
+	previewSources.clear();
+	if (obs_frontend_preview_program_mode_active()) {
+		OBSSourceAutoRelease preview = obs_frontend_get_current_preview_scene();
+		previewSources.collect(preview);
+	}
+
+	for (PTZDevice *ptz : devices) {
+		bool was_live = ptz->isLive(), was_preview = ptz->isPreview(), was_locked = ptz->isLocked();
+		ptz->onSceneChanged(programSources, previewSources);
+		if (ptz->isLive() != was_live)
+			queueDataChanged(ptz, {IsLiveRole});
+		if (ptz->isPreview() != was_preview)
+			queueDataChanged(ptz, {IsPreviewRole});
+		if (ptz->isLocked() != was_locked)
+			queueDataChanged(ptz, {IsLockedRole});
+	}
+}
+
+/* Cached active sources of the program or preview scene, if scene is one */
+const PTZActiveSources *PTZListModel::activeSources(const QString &scene) const
+{
+	if (!scene.isEmpty() && scene == programSources.scene)
+		return &programSources;
+	if (!scene.isEmpty() && scene == previewSources.scene)
+		return &previewSources;
+	return nullptr;
 }
 
 PTZDevice *PTZListModel::getDevice(const QModelIndex &index) const
@@ -272,10 +337,7 @@ PTZDevice *PTZListModel::getDevice(uint32_t device_id) const
 
 PTZDevice *PTZListModel::getDeviceByName(const QString &name) const
 {
-	for (PTZDevice *ptz : devices)
-		if (name == ptz->objectName())
-			return ptz;
-	return nullptr;
+	return devicesByName.value(name, nullptr);
 }
 
 QStringList PTZListModel::getDeviceNames() const
@@ -310,7 +372,7 @@ QModelIndex PTZListModel::indexFromDeviceId(uint32_t device_id)
 {
 	auto ptz = getDevice(device_id);
 	if (ptz)
-		return index(devices.indexOf(ptz), 0);
+		return index(ptz->modelRow, 0);
 	return QModelIndex();
 }
 
@@ -319,10 +381,9 @@ QModelIndex PTZListModel::indexFromDeviceId(uint32_t device_id)
  */
 QModelIndex PTZListModel::indexFromName(const QString &name)
 {
-	for (auto row = 0; row < devices.size(); row++) {
-		if (name == devices.at(row)->objectName())
-			return index(row, 0);
-	}
+	auto ptz = getDeviceByName(name);
+	if (ptz)
+		return index(ptz->modelRow, 0);
 	return QModelIndex();
 }
 
@@ -362,11 +423,21 @@ void PTZListModel::add(PTZDevice *ptz)
 	while (devicesById.contains(id) || id == 0)
 		id++;
 	ptz->id = id;
+
+	int row = devices.size();
+	if (!bulkLoadDepth)
+		beginInsertRows(QModelIndex(), row, row);
+	ptz->modelRow = row;
 	devices.append(ptz);
 	devicesById[ptz->id] = ptz;
-	do_reset();
+	devicesByName[ptz->objectName()] = ptz;
+	ptzSourceIndex.assign(ptz->objectName());
+	if (!bulkLoadDepth)
+		endInsertRows();
 
 	connect(ptz, &PTZDevice::settingsChanged, this, &PTZListModel::deviceSettingsChanged);
+	connect(ptz, &PTZDevice::connectionStatusChanged, this,
+		[this, ptz](bool) { queueDataChanged(ptz, {IsConnectedRole}); });
 }
 
 void PTZListModel::removeDevice(const QModelIndex &index)
@@ -378,9 +449,22 @@ void PTZListModel::removeDevice(const QModelIndex &index)
 
 void PTZListModel::remove(PTZDevice *ptz)
 {
+	int row = ptz->modelRow;
+	if (row < 0 || row >= devices.size() || devices.at(row) != ptz)
+		return;
+
+	if (!bulkLoadDepth)
+		beginRemoveRows(QModelIndex(), row, row);
 	devicesById.remove(ptz->getId());
-	devices.removeAll(ptz);
-	do_reset();
+	if (devicesByName.value(ptz->objectName()) == ptz) {
+		devicesByName.remove(ptz->objectName());
+		ptzSourceIndex.unassign(ptz->objectName());
+	}
+	devices.removeAt(row);
+	ptz->modelRow = -1;
+	updateRows(row);
+	if (!bulkLoadDepth)
+		endRemoveRows();
 }
 
 PTZDevice *PTZListModel::make_device(OBSData config)
@@ -412,8 +496,10 @@ PTZDevice *PTZListModel::make_device(OBSData config)
 void PTZListModel::delete_all()
 {
 	// Devices remove themselves when deleted, so just loop until empty
+	beginBulkLoad();
 	while (!devices.isEmpty())
 		delete devices.first();
+	endBulkLoad();
 }
 
 void PTZListModel::preset_recall(uint32_t device_id, int preset_id)
@@ -430,42 +516,88 @@ void PTZListModel::preset_save(uint32_t device_id, int preset_id)
 		ptz->memory_set(preset_id);
 }
 
-void PTZListModel::deviceSettingsChanged(OBSData)
+/* Refresh the cached row of every device from 'from' onwards */
+void PTZListModel::updateRows(int from)
+{
+	for (int row = std::max(from, 0); row < devices.size(); row++)
+		devices[row]->modelRow = row;
+}
+
+void PTZListModel::queueDataChanged(PTZDevice *ptz, std::initializer_list<int> roles)
+{
+	if (ptz->modelRow < 0 || bulkLoadDepth)
+		return;
+	pendingRoles[ptz->getId()].unite(QSet<int>(roles));
+	if (!pendingFlush) {
+		pendingFlush = true;
+		QTimer::singleShot(16, this, &PTZListModel::flushDataChanged);
+	}
+}
+
+void PTZListModel::flushDataChanged()
 {
-	int row = devices.indexOf(qobject_cast<PTZDevice *>(sender()));
-	if (row < 0)
+	auto pending = std::move(pendingRoles);
+	pendingRoles.clear();
+	pendingFlush = false;
+	for (auto it = pending.cbegin(); it != pending.cend(); it++) {
+		/* The device may have gone away since the change was queued */
+		auto idx = indexFromDeviceId(it.key());
+		if (idx.isValid())
+			emit dataChanged(idx, idx, it.value().values());
+	}
+}
+
+/* Map the properties reported by the device onto the roles they affect */
+void PTZListModel::deviceSettingsChanged(OBSData changed)
+{
+	auto ptz = qobject_cast<PTZDevice *>(sender());
+	if (!ptz)
 		return;
-	auto idx = index(row, 0);
-	emit dataChanged(idx, idx);
+	queueDataChanged(ptz, {SettingsRole});
+	if (obs_data_has_user_value(changed, "focus_af_enabled"))
+		queueDataChanged(ptz, {IsAutofocusRole});
+	for (auto key : {"pan_pos", "tilt_pos", "zoom_pos", "focus_pos"}) {
+		if (obs_data_has_user_value(changed, key)) {
+			queueDataChanged(ptz, {PositionRole});
+			break;
+		}
+	}
 }
 
 void PTZListModel::presetBeginInsert(PTZDevice *ptz, int row)
 {
-	beginInsertRows(indexFromDeviceId(ptz->getId()), row, row);
+	if (!bulkLoadDepth)
+		beginInsertRows(indexFromDeviceId(ptz->getId()), row, row);
 }
 
 void PTZListModel::presetEndInsert(PTZDevice *)
 {
-	endInsertRows();
+	if (!bulkLoadDepth)
+		endInsertRows();
 }
 
 void PTZListModel::presetBeginRemove(PTZDevice *ptz, int row)
 {
-	beginRemoveRows(indexFromDeviceId(ptz->getId()), row, row);
+	if (!bulkLoadDepth)
+		beginRemoveRows(indexFromDeviceId(ptz->getId()), row, row);
 }
 
 void PTZListModel::presetEndRemove(PTZDevice *)
 {
-	endRemoveRows();
+	if (!bulkLoadDepth)
+		endRemoveRows();
 }
 
 bool PTZListModel::presetBeginMove(PTZDevice *ptz, int srcRow, int destRow)
 {
+	if (bulkLoadDepth)
+		return true;
 	auto parent = indexFromDeviceId(ptz->getId());
 	return beginMoveRows(parent, srcRow, srcRow, parent, destRow);
 }
 
 void PTZListModel::presetEndMove(PTZDevice *)
 {
-	endMoveRows();
+	if (!bulkLoadDepth)
+		endMoveRows();
 }
@@ -10,7 +10,9 @@
 #include <QAbstractItemModel>
 #include <QHash>
 #include <QList>
+#include <QSet>
 #include "ptz.h"
+#include "ptz-sources.hpp"
 
 class PTZDevice;
 
@@ -20,6 +22,21 @@ class PTZListModel : public QAbstractItemModel {
 private:
 	QList<PTZDevice *> devices;
 	QHash<uint32_t, PTZDevice *> devicesById;
+	QHash<QString, PTZDevice *> devicesByName;
+	int bulkLoadDepth = 0;
+	void updateRows(int from = 0);
+
+	/* Device state changes are collected per device id and flushed as one
+	 * role-specific dataChanged per device at most once a frame */
+	QHash<uint32_t, QSet<int>> pendingRoles;
+	bool pendingFlush = false;
+	void queueDataChanged(PTZDevice *ptz, std::initializer_list<int> roles);
+	void flushDataChanged();
+
+	/* Sources active in the program and preview scenes, as of the last
+	 * onSceneChanged() */
+	PTZActiveSources programSources;
+	PTZActiveSources previewSources;
 
 public:
 	enum PTZListModelRole {
@@ -30,6 +47,9 @@ public:
 		IsConnectedRole,
 		IsLockedRole,
 		SupportsSetHomeRole,
+		IsAutofocusRole,
+		PositionRole,
+		SettingsRole,
 	};
 
 	PTZListModel();
@@ -44,10 +64,12 @@ public:
 		      int destChild) override;
 	QVariant data(const QModelIndex &index, int role) const override;
 	bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
-	void do_reset();
-	void name_changed(PTZDevice *ptz);
+	void beginBulkLoad();
+	void endBulkLoad();
+	void name_changed(PTZDevice *ptz, const QString &prev_name);
 	Qt::ItemFlags flags(const QModelIndex &index) const override;
 	void onSceneChanged();
+	const PTZActiveSources *activeSources(const QString &scene) const;
 
 	/* Data Model */
 	PTZDevice *make_device(OBSData config);
@@ -11,37 +11,31 @@
 
 #include <qt-wrappers.hpp>
 #include "ptz-onvif.hpp"
-#include <QtXml/QDomDocument>
+#include "onvif-transport.hpp"
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
-#include <QRegularExpression>
+#include <cstring>
+#include <cctype>
 #include <QTimeZone>
+#include <QRandomGenerator>
+#include <QCryptographicHash>
+#include <algorithm>
 
-void PTZOnvif::sendRequest(QString url, QString req)
+quint64 PTZOnvif::sendRequest(QString url, const QByteArray &req, bool urgent, bool longPoll)
 {
 	if (url.isEmpty()) {
 		/* Happens when an operation fires before GetCapabilities has
 		 * populated the per-service XAddrs (e.g. the camera was added
 		 * with an unreachable host). Quietly drop instead of letting
 		 * Qt spam "Protocol \"\" is unknown" once per command. */
-		return;
+		return 0;
 	}
-	QNetworkRequest request(url);
-	request.setHeader(QNetworkRequest::ContentTypeHeader, "application/soap+xml; charset=utf-8");
-	/* Surface failures in seconds instead of waiting on the OS TCP
-	 * timeout (~2 min). 10s is generous for an ONVIF SOAP exchange. */
-	request.setTransferTimeout(10000);
-	/* Authentication is carried in the SOAP envelope via WS-Security
-	 * UsernameToken (see writeHeader). If a camera actually demands HTTP
-	 * Digest, authRequired() supplies it on demand. Sending a Basic
-	 * Authorization header unconditionally caused some firmwares to
-	 * reject the request as ambiguous. */
-	m_networkManager.post(request, req.toUtf8());
+	return OnvifTransport::get()->post(this, url, req, urgent, longPoll);
 }
 
-void PTZOnvif::authRequired(QNetworkReply *, QAuthenticator *authenticator)
+quint64 PTZOnvif::sendRequest(QString url, QString req)
 {
-	authenticator->setUser(username);
-	authenticator->setPassword(password);
+	return sendRequest(url, req.toUtf8());
 }
 
 const QString nsXmlSchema("http://www.w3.org/2001/XMLSchema");                  //xsd
@@ -55,6 +49,9 @@ const QString nsOnvifMedia("http://www.onvif.org/ver10/media/wsdl");
 const QString nsOnvifPtz("http://www.onvif.org/ver20/ptz/wsdl");                //tptz
 const QString nsWssSecext("http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-secext-1.0.xsd");   //wsse
 const QString nsWssUtility("http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-utility-1.0.xsd"); //wsu
+const QString nsOnvifEvents("http://www.onvif.org/ver10/events/wsdl");          //tev
+const QString nsWsnBase("http://docs.oasis-open.org/wsn/b-2");                  //wsnt
+const QString nsOnvifTopics("http://www.onvif.org/ver10/topics");               //tns1
 const QString nsWssPasswordDigest(
 	"http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-username-token-profile-1.0#PasswordDigest");
 
@@ -76,16 +73,27 @@ static void writeStartOnvifDocument(QXmlStreamWriter &s)
 	s.writeNamespace(nsWssUtility, "wsu");
 }
 
-void PTZOnvif::writeHeader(QXmlStreamWriter &s, const QString action = "")
+/* WS-Security nonce shared by both header paths: 16 random bytes. The
+ * digest is taken over the raw bytes; the header carries them base64
+ * encoded. */
+static QByteArray makeNonce()
+{
+	quint32 words[4];
+	QRandomGenerator::global()->fillRange(words);
+	return QByteArray(reinterpret_cast<const char *>(words), sizeof(words));
+}
+
+void PTZOnvif::writeHeader(QXmlStreamWriter &s, const QString action = "", const QString to = "")
 {
-	QUuid nonce = QUuid::createUuid();
-	QString nonce64 = nonce.toByteArray().toBase64();
+	QByteArray nonce = makeNonce();
+	QString nonce64 = nonce.toBase64();
 	/* Adjust by the per-camera clock offset so cameras with bad NTP
 	 * don't reject our WS-Security timestamp. */
 	auto timestamp = QDateTime::currentDateTimeUtc().addSecs(m_timeOffsetSecs).toString(Qt::ISODate);
-	auto token = nonce.toString() + timestamp + password;
 	QCryptographicHash hash(QCryptographicHash::Sha1);
-	hash.addData(token.toUtf8());
+	hash.addData(nonce);
+	hash.addData(timestamp.toUtf8());
+	hash.addData(password.toUtf8());
 	QString hashTokenBase64 = hash.result().toBase64();
 
 	s.writeStartElement(nsSoapEnvelope, "Header");
@@ -95,6 +103,14 @@ void PTZOnvif::writeHeader(QXmlStreamWriter &s, const QString action = "")
 		s.writeCharacters(action);
 		s.writeEndElement(); // Action
 	}
+	if (to != "") {
+		/* Subscription managers are typically multiplexed on a single
+		 * URL and tell subscriptions apart by the To header. */
+		s.writeStartElement(nsAddressing, "To");
+		s.writeAttribute(nsSoapEnvelope, "mustUnderstand", "1");
+		s.writeCharacters(to);
+		s.writeEndElement(); // To
+	}
 	s.writeStartElement(nsWssSecext, "Security");
 	s.writeAttribute(nsSoapEnvelope, "mustUnderstand", "1");
 	s.writeStartElement(nsWssSecext, "UsernameToken");
@@ -113,6 +129,88 @@ void PTZOnvif::writeHeader(QXmlStreamWriter &s, const QString action = "")
 	s.writeEndElement(); // Header
 }
 
+/*
+ * Fast path envelopes
+ *
+ * The QXmlStreamWriter path above is fine for one-off management requests,
+ * but ContinuousMove is sent at joystick rate and GetStatus on every poll.
+ * For those the envelope is pre-rendered as UTF-8 bytes, with the same
+ * namespace prefixes the writer path uses, so that each request is a handful
+ * of appends plus one SHA-1 over ~60 bytes.
+ */
+static const QByteArray fastEnvelopeHead = QByteArrayLiteral(
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	"<SOAP-ENV:Envelope"
+	" xmlns:SOAP-ENV=\"http://www.w3.org/2003/05/soap-envelope\""
+	" xmlns:wsa5=\"http://www.w3.org/2005/08/addressing\""
+	" xmlns:tt=\"http://www.onvif.org/ver10/schema\""
+	" xmlns:tptz=\"http://www.onvif.org/ver20/ptz/wsdl\""
+	" xmlns:wsse=\"http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-secext-1.0.xsd\""
+	" xmlns:wsu=\"http://docs.oasis-open.org/wss/2004/01/oasis-200401-wss-wssecurity-utility-1.0.xsd\">"
+	"<SOAP-ENV:Header><wsa5:Action SOAP-ENV:mustUnderstand=\"1\">");
+static const QByteArray fastEnvelopeTail = QByteArrayLiteral("</SOAP-ENV:Body></SOAP-ENV:Envelope>");
+static const QByteArray actionContinuousMove = QByteArrayLiteral("http://www.onvif.org/ver20/ptz/wsdl/ContinuousMove");
+static const QByteArray actionStop = QByteArrayLiteral("http://www.onvif.org/ver20/ptz/wsdl/Stop");
+static const QByteArray actionGetStatus = QByteArrayLiteral("http://www.onvif.org/ver20/ptz/wsdl/GetStatus");
+
+static QByteArray xmlEscaped(const QString &text)
+{
+	return text.toHtmlEscaped().toUtf8();
+}
+
+void PTZOnvif::updateTemplates()
+{
+	m_tplProfileToken = m_selectedMedia.token;
+	m_passwordUtf8 = password.toUtf8();
+
+	QByteArray digestType = nsWssPasswordDigest.toUtf8();
+	m_tplSecurity = "</wsa5:Action><wsse:Security SOAP-ENV:mustUnderstand=\"1\"><wsse:UsernameToken>"
+			"<wsse:Username>" +
+			xmlEscaped(username) + "</wsse:Username><wsse:Password Type=\"" + digestType + "\">";
+
+	QByteArray token = "<tptz:ProfileToken>" + xmlEscaped(m_tplProfileToken) + "</tptz:ProfileToken>";
+	m_tplMoveBody = "<tptz:ContinuousMove>" + token + "<tptz:Velocity><tt:PanTilt x=\"";
+	m_tplStopBody = "<tptz:Stop>" + token +
+			"<tptz:PanTilt>true</tptz:PanTilt><tptz:Zoom>true</tptz:Zoom></tptz:Stop>";
+	m_tplStatusBody = "<tptz:GetStatus>" + token + "</tptz:GetStatus>";
+}
+
+QByteArray PTZOnvif::buildFastEnvelope(const QByteArray &action, const QByteArray &body)
+{
+	/* The Created timestamp has one second resolution, so only format it
+	 * when the second rolls over. */
+	QDateTime now = QDateTime::currentDateTimeUtc().addSecs(m_timeOffsetSecs);
+	qint64 secs = now.toSecsSinceEpoch();
+	if (secs != m_createdSecs || m_created.isEmpty()) {
+		m_createdSecs = secs;
+		m_created = now.toString(Qt::ISODate).toUtf8();
+	}
+
+	/* Digest = Base64(SHA1(nonce + created + password)), as in writeHeader() */
+	QByteArray rawNonce = makeNonce();
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(rawNonce);
+	hash.addData(m_created);
+	hash.addData(m_passwordUtf8);
+
+	static const QByteArray nonceOpen = "</wsse:Password><wsse:Nonce EncodingType=\"" +
+					    nsWssPasswordDigest.toUtf8() + "\">";
+	QByteArray out;
+	out.reserve(fastEnvelopeHead.size() + m_tplSecurity.size() + body.size() + 512);
+	out += fastEnvelopeHead;
+	out += action;
+	out += m_tplSecurity;
+	out += hash.result().toBase64();
+	out += nonceOpen;
+	out += rawNonce.toBase64();
+	out += "</wsse:Nonce><wsu:Created>";
+	out += m_created;
+	out += "</wsu:Created></wsse:UsernameToken></wsse:Security></SOAP-ENV:Header><SOAP-ENV:Body>";
+	out += body;
+	out += fastEnvelopeTail;
+	return out;
+}
+
 static void writePanTilt(QXmlStreamWriter &s, double pan, double tilt)
 {
 	s.writeEmptyElement(nsOnvifSchema, "PanTilt");
@@ -126,7 +224,7 @@ static void writeZoom(QXmlStreamWriter &s, double zoom)
 	s.writeAttribute("x", QString::number(zoom));
 }
 
-void PTZOnvif::genericMove(QString movetype, QString property, double x, double y, double z)
+quint64 PTZOnvif::genericMove(QString movetype, QString property, double x, double y, double z)
 {
 	QString msg;
 	QXmlStreamWriter s(&msg);
@@ -144,12 +242,24 @@ void PTZOnvif::genericMove(QString movetype, QString property, double x, double
 	s.writeEndElement(); // Body
 	s.writeEndElement(); // Envelope
 	s.writeEndDocument();
-	sendRequest(m_PTZAddress, msg);
+	return sendRequest(m_PTZAddress, msg);
 }
 
-void PTZOnvif::continuousMove(double x, double y, double z)
+quint64 PTZOnvif::continuousMove(double x, double y, double z)
 {
-	genericMove("ContinuousMove", "Velocity", x, y, z);
+	if (m_tplProfileToken != m_selectedMedia.token || m_tplMoveBody.isEmpty())
+		updateTemplates();
+
+	QByteArray body;
+	body.reserve(m_tplMoveBody.size() + 96);
+	body += m_tplMoveBody;
+	body += QByteArray::number(x);
+	body += "\" y=\"";
+	body += QByteArray::number(y);
+	body += "\"/><tt:Zoom x=\"";
+	body += QByteArray::number(z);
+	body += "\"/></tptz:Velocity></tptz:ContinuousMove>";
+	return sendRequest(m_PTZAddress, buildFastEnvelope(actionContinuousMove, body), true);
 }
 
 void PTZOnvif::absoluteMove(double x, double y, double z)
@@ -162,23 +272,11 @@ void PTZOnvif::relativeMove(double x, double y, double z)
 	genericMove("RelativeMove", "Translation", x, y, z);
 }
 
-void PTZOnvif::stop()
+quint64 PTZOnvif::stop()
 {
-	QString msg;
-	QXmlStreamWriter s(&msg);
-	writeStartOnvifDocument(s);
-	s.writeStartElement(nsSoapEnvelope, "Envelope");
-	writeHeader(s, nsOnvifPtz + "/" + "Stop");
-	s.writeStartElement(nsSoapEnvelope, "Body");
-	s.writeStartElement(nsOnvifPtz, "Stop");
-	s.writeTextElement(nsOnvifPtz, "ProfileToken", m_selectedMedia.token);
-	s.writeTextElement(nsOnvifPtz, "PanTilt", "true");
-	s.writeTextElement(nsOnvifPtz, "Zoom", "true");
-	s.writeEndElement(); // movetype
-	s.writeEndElement(); // Body
-	s.writeEndElement(); // Envelope
-	s.writeEndDocument();
-	sendRequest(m_PTZAddress, msg);
+	if (m_tplProfileToken != m_selectedMedia.token || m_tplStopBody.isEmpty())
+		updateTemplates();
+	return sendRequest(m_PTZAddress, buildFastEnvelope(actionStop, m_tplStopBody), true);
 }
 
 void PTZOnvif::goToHomePosition()
@@ -219,8 +317,8 @@ void PTZOnvif::pantilt_set_home()
 
 void PTZOnvif::memory_set(int i)
 {
-	QString token = presetProperty(i, "token").toString();
-	QString name = presetProperty(i, "name").toString();
+	QString token = presetToken(i);
+	QString name = presetName(i);
 	/* Remember which slot the response should be filed under, so we can
 	 * link the camera-assigned PresetToken back to the right local slot. */
 	m_pendingSetPresetSlot = i;
@@ -245,7 +343,7 @@ void PTZOnvif::memory_set(int i)
 
 void PTZOnvif::memory_reset(int i)
 {
-	QString token = presetProperty(i, "token").toString();
+	QString token = presetToken(i);
 	if (token == "")
 		return;
 	QString msg;
@@ -265,14 +363,12 @@ void PTZOnvif::memory_reset(int i)
 	/* The preset is gone from the camera; clear the stale token locally so
 	 * a future memory_set on this slot creates a new one instead of trying
 	 * to update a token the camera doesn't know about. */
-	QVariantMap clear;
-	clear["token"] = QString();
-	updatePreset(i, clear);
+	setPresetToken(i, QString());
 }
 
 void PTZOnvif::memory_recall(int i)
 {
-	QString token = presetProperty(i, "token").toString();
+	QString token = presetToken(i);
 	if (token == "")
 		return;
 	QString msg;
@@ -289,6 +385,7 @@ void PTZOnvif::memory_recall(int i)
 	s.writeEndElement(); // Envelope
 	s.writeEndDocument();
 	sendRequest(m_PTZAddress, msg);
+	trackMotion();
 }
 
 void PTZOnvif::getPresets()
@@ -308,97 +405,246 @@ void PTZOnvif::getPresets()
 	sendRequest(m_PTZAddress, msg);
 }
 
-void PTZOnvif::getStatus()
+void PTZOnvif::getStatus(bool latest)
 {
 	if (m_PTZAddress.isEmpty() || m_selectedMedia.token.isEmpty())
 		return;
-	QString msg;
-	QXmlStreamWriter s(&msg);
-	writeStartOnvifDocument(s);
-	s.writeStartElement(nsSoapEnvelope, "Envelope");
-	writeHeader(s, nsOnvifPtz + "/" + "GetStatus");
-	s.writeStartElement(nsSoapEnvelope, "Body");
-	s.writeStartElement(nsOnvifPtz, "GetStatus");
-	s.writeTextElement(nsOnvifPtz, "ProfileToken", m_selectedMedia.token);
-	s.writeEndElement(); // GetStatus
-	s.writeEndElement(); // Body
-	s.writeEndElement(); // Envelope
-	s.writeEndDocument();
-	sendRequest(m_PTZAddress, msg);
+	/* Don't stack up polls behind a camera that is slow to answer. A caller
+	 * that needs the state from after its own cue gets one more request
+	 * once the current reply is in. */
+	if (m_statusRequest) {
+		m_statusAgain = m_statusAgain || latest;
+		return;
+	}
+	if (m_tplProfileToken != m_selectedMedia.token || m_tplStatusBody.isEmpty())
+		updateTemplates();
+	m_statusRequest = sendRequest(m_PTZAddress, buildFastEnvelope(actionGetStatus, m_tplStatusBody));
+}
+
+/* Returns true if the text following an '&' is one of the entities XML
+ * knows about; p points just past the '&'. */
+static bool isXmlEntity(const char *p, const char *end)
+{
+	static const char *const named[] = {"amp;", "lt;", "gt;", "quot;", "apos;"};
+	for (const char *n : named) {
+		size_t len = strlen(n);
+		if ((size_t)(end - p) >= len && memcmp(p, n, len) == 0)
+			return true;
+	}
+	if (p >= end || *p != '#')
+		return false;
+	p++;
+	bool hex = p < end && *p == 'x';
+	if (hex)
+		p++;
+	const char *digits = p;
+	while (p < end && (hex ? isxdigit((unsigned char)*p) : isdigit((unsigned char)*p)))
+		p++;
+	return p > digits && p < end && *p == ';';
+}
+
+/* Some firmwares emit unescaped '&' in URI text content (notably in
+ * GetStreamUri responses with `&channel=`/`&protocol=`). That's invalid
+ * XML and the reader rejects the whole document, so escape any bare '&'.
+ * Well-formed replies, which is nearly all of them, are returned without
+ * a copy. */
+static QByteArray repairStrayAmpersands(const QByteArray &in)
+{
+	const char *begin = in.constData();
+	const char *end = begin + in.size();
+	const char *copied = begin;
+	QByteArray out;
+
+	for (const char *p = (const char *)memchr(begin, '&', end - begin); p;
+	     p = (const char *)memchr(p + 1, '&', end - p - 1)) {
+		if (isXmlEntity(p + 1, end))
+			continue;
+		if (out.isEmpty())
+			out.reserve(in.size() + 64);
+		out.append(copied, p + 1 - copied);
+		out.append("amp;");
+		copied = p + 1;
+	}
+	if (copied == begin)
+		return in;
+	out.append(copied, end - copied);
+	return out;
 }
 
-void PTZOnvif::handleResponse(QString response)
-{
-	/* Some firmwares emit unescaped '&' in URI text content (notably in
-	 * GetStreamUri responses with `&channel=`/`&protocol=`). That's
-	 * invalid XML and Qt's QDomDocument rejects the whole document.
-	 * Replace any bare '&' not starting a known entity with '&amp;'. */
-	static const QRegularExpression ampFix(QStringLiteral("&(?!(?:amp|lt|gt|quot|apos|#[0-9]+|#x[0-9a-fA-F]+);)"));
-	response.replace(ampFix, "&amp;");
-
-	QDomDocument doc;
-	QDomNodeList nl;
-
-#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
-	QDomDocument::ParseOptions options = QDomDocument::ParseOption::UseNamespaceProcessing;
-	doc.setContent(QAnyStringView(response), options);
-#else
-	doc.setContent(response, true);
-#endif
-
-	nl = doc.elementsByTagNameNS(nsOnvifDevice, "GetSystemDateAndTimeResponse");
-	for (int i = 0; i < nl.length(); i++)
-		handleGetSystemDateAndTimeResponse(nl.at(i));
-	nl = doc.elementsByTagNameNS(nsOnvifDevice, "GetCapabilitiesResponse");
-	for (int i = 0; i < nl.length(); i++)
-		handleGetCapabilitiesResponse(nl.at(i));
-	nl = doc.elementsByTagNameNS(nsOnvifMedia, "GetProfilesResponse");
-	for (int i = 0; i < nl.length(); i++)
-		handleGetProfilesResponse(nl.at(i));
-	handleGetPresetsResponse(doc);
-	handleSetPresetResponse(doc);
-	nl = doc.elementsByTagNameNS(nsOnvifPtz, "GetStatusResponse");
-	for (int i = 0; i < nl.length(); i++)
-		handleGetStatusResponse(nl.at(i));
-}
-
-void PTZOnvif::handleGetStatusResponse(QDomNode node)
-{
-	auto statusEl = node.toElement().firstChildElement("PTZStatus", nsOnvifPtz);
-	if (statusEl.isNull())
+/* Returns true if the response is a SOAP Fault and fills in its reason:
+ * Reason/Text for SOAP 1.2, faultstring for cameras that answer in 1.1. */
+static bool parseSoapFault(const QByteArray &response, QString &reason)
+{
+	QXmlStreamReader xml(repairStrayAmpersands(response));
+	if (!xml.readNextStartElement() || xml.name() != QLatin1String("Envelope"))
+		return false;
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("Body")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		if (!xml.readNextStartElement() || xml.name() != QLatin1String("Fault"))
+			return false;
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("faultstring")) {
+				reason = xml.readElementText().trimmed();
+			} else if (xml.name() == QLatin1String("Reason")) {
+				while (xml.readNextStartElement()) {
+					if (xml.name() == QLatin1String("Text") && reason.isEmpty())
+						reason = xml.readElementText().trimmed();
+					else
+						xml.skipCurrentElement();
+				}
+			} else {
+				xml.skipCurrentElement();
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+void PTZOnvif::handleResponse(const QByteArray &response)
+{
+	QXmlStreamReader xml(repairStrayAmpersands(response));
+
+	/* The response type is the first child of the SOAP Body; everything
+	 * before it (the Header) is skipped without being looked at. */
+	if (!xml.readNextStartElement() || xml.name() != QLatin1String("Envelope"))
 		return;
-	auto posEl = statusEl.firstChildElement("Position", nsOnvifSchema);
-	if (posEl.isNull())
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("Body")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		if (!xml.readNextStartElement())
+			return;
+
+		auto ns = xml.namespaceUri();
+		auto name = xml.name();
+		if (ns == nsOnvifPtz && name == QLatin1String("GetStatusResponse"))
+			handleGetStatusResponse(xml);
+		else if (ns == nsOnvifPtz && name == QLatin1String("GetPresetsResponse"))
+			handleGetPresetsResponse(xml);
+		else if (ns == nsOnvifPtz && name == QLatin1String("SetPresetResponse"))
+			handleSetPresetResponse(xml);
+		else if (ns == nsOnvifDevice && name == QLatin1String("GetSystemDateAndTimeResponse"))
+			handleGetSystemDateAndTimeResponse(xml);
+		else if (ns == nsOnvifDevice && name == QLatin1String("GetCapabilitiesResponse"))
+			handleGetCapabilitiesResponse(xml);
+		else if (ns == nsOnvifMedia && name == QLatin1String("GetProfilesResponse"))
+			handleGetProfilesResponse(xml);
+		else if (ns == nsOnvifEvents && name == QLatin1String("PullMessagesResponse"))
+			handlePullMessagesResponse(xml);
+		else if (ns == nsOnvifEvents && name == QLatin1String("CreatePullPointSubscriptionResponse"))
+			handleCreatePullPointSubscriptionResponse(xml);
 		return;
-	auto ptEl = posEl.firstChildElement("PanTilt", nsOnvifSchema);
-	if (!ptEl.isNull()) {
-		m_position_pan = ptEl.attribute("x").toDouble();
-		m_position_tilt = ptEl.attribute("y").toDouble();
 	}
-	auto zoomEl = posEl.firstChildElement("Zoom", nsOnvifSchema);
-	if (!zoomEl.isNull())
-		m_position_zoom = zoomEl.attribute("x").toDouble();
-	ptz_debug("status: pan=%.3f tilt=%.3f zoom=%.3f", m_position_pan, m_position_tilt, m_position_zoom);
-}
-
-void PTZOnvif::handleGetSystemDateAndTimeResponse(QDomNode node)
-{
-	auto sysEl = node.toElement().firstChildElement("SystemDateAndTime", nsOnvifDevice);
-	auto utcEl = sysEl.firstChildElement("UTCDateTime", nsOnvifSchema);
-	if (!utcEl.isNull()) {
-		auto dateEl = utcEl.firstChildElement("Date", nsOnvifSchema);
-		auto timeEl = utcEl.firstChildElement("Time", nsOnvifSchema);
-		int y = dateEl.firstChildElement("Year", nsOnvifSchema).text().toInt();
-		int mo = dateEl.firstChildElement("Month", nsOnvifSchema).text().toInt();
-		int d = dateEl.firstChildElement("Day", nsOnvifSchema).text().toInt();
-		int h = timeEl.firstChildElement("Hour", nsOnvifSchema).text().toInt();
-		int mi = timeEl.firstChildElement("Minute", nsOnvifSchema).text().toInt();
-		int se = timeEl.firstChildElement("Second", nsOnvifSchema).text().toInt();
+	if (xml.hasError())
+		ptz_debug("malformed response: %s", QT_TO_UTF8(xml.errorString()));
+}
+
+void PTZOnvif::handleGetStatusResponse(QXmlStreamReader &xml)
+{
+	double pan = m_position_pan, tilt = m_position_tilt, zoom = m_position_zoom;
+	bool haveMoveStatus = false;
+	bool moving = false;
+
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("PTZStatus")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("Position")) {
+				while (xml.readNextStartElement()) {
+					auto attrs = xml.attributes();
+					if (xml.name() == QLatin1String("PanTilt")) {
+						pan = attrs.value("x").toDouble();
+						tilt = attrs.value("y").toDouble();
+					} else if (xml.name() == QLatin1String("Zoom")) {
+						zoom = attrs.value("x").toDouble();
+					}
+					xml.skipCurrentElement();
+				}
+			} else if (xml.name() == QLatin1String("MoveStatus")) {
+				/* PanTilt and Zoom are IDLE, MOVING or UNKNOWN */
+				while (xml.readNextStartElement()) {
+					haveMoveStatus = true;
+					if (xml.readElementText().trimmed() != QLatin1String("IDLE"))
+						moving = true;
+				}
+			} else {
+				xml.skipCurrentElement();
+			}
+		}
+	}
+
+	/* Cameras that don't report MoveStatus are considered idle once the
+	 * position stops changing. */
+	if (!haveMoveStatus)
+		moving = pan != m_position_pan || tilt != m_position_tilt || zoom != m_position_zoom;
+	m_position_pan = pan;
+	m_position_tilt = tilt;
+	m_position_zoom = zoom;
+	ptz_debug("status: pan=%.3f tilt=%.3f zoom=%.3f%s", m_position_pan, m_position_tilt, m_position_zoom,
+		  moving ? " (moving)" : "");
+
+	OBSDataAutoRelease pos = obs_data_create();
+	obs_data_set_double(pos, "pan_pos", pan);
+	obs_data_set_double(pos, "tilt_pos", tilt);
+	obs_data_set_double(pos, "zoom_pos", zoom);
+	if (applySettings(pos))
+		emit settingsChanged(pos.Get());
+
+	if (!m_movePollTimer.isActive())
+		return;
+	if (moving || pan_speed != 0.0 || tilt_speed != 0.0 || zoom_speed != 0.0)
+		m_idlePolls = 0;
+	else if (++m_idlePolls >= 2)
+		m_movePollTimer.stop();
+}
+
+void PTZOnvif::handleGetSystemDateAndTimeResponse(QXmlStreamReader &xml)
+{
+	/* Only UTCDateTime is of interest; LocalDateTime has the same child
+	 * element names so the values are only collected inside it. */
+	int dt[6] = {0, 0, 0, 0, 0, 0};
+	bool haveUtc = false;
+	static const char *const fields[] = {"Year", "Month", "Day", "Hour", "Minute", "Second"};
+
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("SystemDateAndTime")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		while (xml.readNextStartElement()) {
+			if (xml.name() != QLatin1String("UTCDateTime")) {
+				xml.skipCurrentElement();
+				continue;
+			}
+			haveUtc = true;
+			while (xml.readNextStartElement()) { // Date, Time
+				while (xml.readNextStartElement()) {
+					for (int i = 0; i < 6; i++) {
+						if (xml.name() == QLatin1String(fields[i])) {
+							dt[i] = xml.readElementText().toInt();
+							break;
+						}
+					}
+					if (!xml.isEndElement())
+						xml.skipCurrentElement();
+				}
+			}
+		}
+	}
+
+	if (haveUtc) {
 		/* Construct as local-naive then re-anchor to UTC. The
 		 * (QDate, QTime, Qt::TimeSpec) constructor was deprecated in
 		 * Qt 6.5 (MSVC -Werror flags it); setTimeZone(QTimeZone::utc())
 		 * does the same thing and is portable back to Qt 5.2. */
-		QDateTime cameraTime(QDate(y, mo, d), QTime(h, mi, se));
+		QDateTime cameraTime(QDate(dt[0], dt[1], dt[2]), QTime(dt[3], dt[4], dt[5]));
 		cameraTime.setTimeZone(QTimeZone::utc());
 		if (cameraTime.isValid()) {
 			m_timeOffsetSecs = QDateTime::currentDateTimeUtc().secsTo(cameraTime);
@@ -410,22 +656,20 @@ void PTZOnvif::handleGetSystemDateAndTimeResponse(QDomNode node)
 	ensureCapabilitiesRequested();
 }
 
-void PTZOnvif::handleSetPresetResponse(QDomDocument &doc)
+void PTZOnvif::handleSetPresetResponse(QXmlStreamReader &xml)
 {
 	if (m_pendingSetPresetSlot < 0)
 		return;
-	auto nl = doc.elementsByTagNameNS(nsOnvifPtz, "SetPresetResponse");
-	if (nl.isEmpty())
-		return;
-	auto tokenNodes = nl.at(0).toElement().elementsByTagNameNS(nsOnvifPtz, "PresetToken");
-	if (tokenNodes.isEmpty())
-		return;
-	QString newToken = tokenNodes.at(0).toElement().text().trimmed();
+	QString newToken;
+	while (xml.readNextStartElement()) {
+		if (xml.name() == QLatin1String("PresetToken"))
+			newToken = xml.readElementText().trimmed();
+		else
+			xml.skipCurrentElement();
+	}
 	if (newToken.isEmpty())
 		return;
-	QVariantMap map;
-	map["token"] = newToken;
-	updatePreset(m_pendingSetPresetSlot, map);
+	setPresetToken(m_pendingSetPresetSlot, newToken);
 	m_pendingSetPresetSlot = -1;
 }
 
@@ -448,46 +692,67 @@ static QString rewriteXAddrHost(const QString &xaddr, const QString &knownHost)
 	return url.toString();
 }
 
-void PTZOnvif::handleGetCapabilitiesResponse(QDomNode node)
+void PTZOnvif::handleGetCapabilitiesResponse(QXmlStreamReader &xml)
 {
-	auto responseElement = node.toElement();
-	auto pl = responseElement.elementsByTagNameNS(nsOnvifSchema, "PTZ");
-	for (int i = 0; i < pl.length(); i++) {
-		auto e = pl.at(i).toElement();
-		m_PTZAddress = rewriteXAddrHost(e.firstChildElement("XAddr", nsOnvifSchema).text(), host);
-	}
-
-	pl = responseElement.elementsByTagNameNS(nsOnvifSchema, "Media");
-	for (int i = 0; i < pl.length(); i++) {
-		auto e = pl.at(i).toElement();
-		m_mediaXAddr = rewriteXAddrHost(e.firstChildElement("XAddr", nsOnvifSchema).text(), host);
-	}
-
-	/* Imaging service hosts focus and white balance controls. Optional. */
-	pl = responseElement.elementsByTagNameNS(nsOnvifSchema, "Imaging");
-	for (int i = 0; i < pl.length(); i++) {
-		auto e = pl.at(i).toElement();
-		m_imagingXAddr = rewriteXAddrHost(e.firstChildElement("XAddr", nsOnvifSchema).text(), host);
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("Capabilities")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		while (xml.readNextStartElement()) {
+			/* Imaging service hosts focus and white balance controls. Optional. */
+			QString *xaddr = nullptr;
+			if (xml.namespaceUri() == nsOnvifSchema) {
+				if (xml.name() == QLatin1String("PTZ"))
+					xaddr = &m_PTZAddress;
+				else if (xml.name() == QLatin1String("Media"))
+					xaddr = &m_mediaXAddr;
+				else if (xml.name() == QLatin1String("Imaging"))
+					xaddr = &m_imagingXAddr;
+				else if (xml.name() == QLatin1String("Events"))
+					xaddr = &m_eventsXAddr;
+			}
+			if (!xaddr) {
+				xml.skipCurrentElement();
+				continue;
+			}
+			while (xml.readNextStartElement()) {
+				if (xml.name() == QLatin1String("XAddr"))
+					*xaddr = rewriteXAddrHost(xml.readElementText(), host);
+				else
+					xml.skipCurrentElement();
+			}
+		}
 	}
 	getProfiles();
 }
 
-void PTZOnvif::handleGetProfilesResponse(QDomNode n)
+void PTZOnvif::handleGetProfilesResponse(QXmlStreamReader &xml)
 {
 	m_mediaProfiles.clear();
-	auto pl = n.toElement().elementsByTagNameNS(nsOnvifMedia, "Profiles");
-	for (int i = 0; i < pl.length(); i++) {
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("Profiles")) {
+			xml.skipCurrentElement();
+			continue;
+		}
 		MediaProfile pro;
-		auto e = pl.at(i).toElement();
-		pro.token = e.attribute("token");
-		pro.name = e.firstChildElement("Name", nsOnvifSchema).text();
-		/* The Imaging service is keyed by VideoSourceToken (not profile
-		 * token), so grab it from the VideoSourceConfiguration. */
-		auto vsCfg = e.firstChildElement("VideoSourceConfiguration", nsOnvifSchema);
-		if (!vsCfg.isNull()) {
-			auto src = vsCfg.firstChildElement("SourceToken", nsOnvifSchema);
-			if (!src.isNull())
-				pro.videoSourceToken = src.text().trimmed();
+		pro.token = xml.attributes().value("token").toString();
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("Name")) {
+				pro.name = xml.readElementText();
+			} else if (xml.name() == QLatin1String("VideoSourceConfiguration")) {
+				/* The Imaging service is keyed by VideoSourceToken (not
+				 * profile token), so grab it from the
+				 * VideoSourceConfiguration. */
+				while (xml.readNextStartElement()) {
+					if (xml.name() == QLatin1String("SourceToken"))
+						pro.videoSourceToken = xml.readElementText().trimmed();
+					else
+						xml.skipCurrentElement();
+				}
+			} else {
+				xml.skipCurrentElement();
+			}
 		}
 		m_mediaProfiles.push_back(pro);
 	}
@@ -495,6 +760,18 @@ void PTZOnvif::handleGetProfilesResponse(QDomNode n)
 		getPresets();
 		return;
 	}
+	selectProfile();
+	getPresets();
+	applyImagingIfPending();
+	getStatus();
+	if (m_useEvents && !m_eventsActive && !m_subscribeRequest)
+		createPullPointSubscription();
+}
+
+void PTZOnvif::selectProfile()
+{
+	if (m_mediaProfiles.isEmpty())
+		return;
 	/* Prefer the profile token the user selected last time, if it still
 	 * exists on the camera; otherwise fall back to the first one. */
 	m_selectedMedia = m_mediaProfiles.first();
@@ -506,33 +783,186 @@ void PTZOnvif::handleGetProfilesResponse(QDomNode n)
 			}
 		}
 	}
-	getPresets();
-	applyImagingIfPending();
 }
 
-void PTZOnvif::handleGetPresetsResponse(QDomDocument &doc)
+void PTZOnvif::handleGetPresetsResponse(QXmlStreamReader &xml)
 {
-	QDomNodeList nodes = doc.elementsByTagNameNS(nsOnvifPtz, "Preset");
-	for (int i = 0; i < nodes.length(); i++) {
-		auto node = nodes.at(i).toElement();
-		QString token = node.attribute("token");
-		auto child = node.firstChildElement("Name", nsOnvifSchema);
-		QString name = child.text();
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("Preset")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		QString token = xml.attributes().value("token").toString();
+		QString name;
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("Name"))
+				name = xml.readElementText();
+			else
+				xml.skipCurrentElement();
+		}
 		if (token == "")
 			continue;
 
-		QVariantMap map;
-		auto psid = findPreset("token", token);
+		auto psid = findPresetByToken(token);
 		if (psid < 0) {
 			psid = newPreset();
-			map["token"] = token;
+			if (psid < 0)
+				continue;
+			setPresetToken(psid, token);
 		}
-		if (psid < 0)
-			continue;
 		if (name != "")
-			map["name"] = name;
-		updatePreset(psid, map);
+			setPresetName(psid, name);
+	}
+}
+
+/*
+ * Events
+ *
+ * PTZ state changes are picked up from a PullPoint subscription when the
+ * camera has an Events service and the user enabled it. PullMessages is
+ * long-polled, so an idle camera costs one outstanding request and no
+ * GetStatus traffic at all.
+ */
+void PTZOnvif::createPullPointSubscription()
+{
+	if (m_eventsXAddr.isEmpty())
+		return;
+	QString msg;
+	QXmlStreamWriter s(&msg);
+	writeStartOnvifDocument(s);
+	s.writeNamespace(nsOnvifEvents, "tev");
+	s.writeNamespace(nsWsnBase, "wsnt");
+	s.writeNamespace(nsOnvifTopics, "tns1");
+	s.writeStartElement(nsSoapEnvelope, "Envelope");
+	writeHeader(s, nsOnvifEvents + "/EventPortType/CreatePullPointSubscriptionRequest");
+	s.writeStartElement(nsSoapEnvelope, "Body");
+	s.writeStartElement(nsOnvifEvents, "CreatePullPointSubscription");
+	s.writeStartElement(nsOnvifEvents, "Filter");
+	s.writeStartElement(nsWsnBase, "TopicExpression");
+	s.writeAttribute("Dialect", "http://www.onvif.org/ver10/tev/topicExpression/ConcreteSet");
+	s.writeCharacters("tns1:PTZController//.");
+	s.writeEndElement(); // TopicExpression
+	s.writeEndElement(); // Filter
+	s.writeTextElement(nsOnvifEvents, "InitialTerminationTime", "PT60S");
+	s.writeEndElement(); // CreatePullPointSubscription
+	s.writeEndElement(); // Body
+	s.writeEndElement(); // Envelope
+	s.writeEndDocument();
+	m_subscribeRequest = sendRequest(m_eventsXAddr, msg);
+}
+
+void PTZOnvif::handleCreatePullPointSubscriptionResponse(QXmlStreamReader &xml)
+{
+	QString address;
+	while (xml.readNextStartElement()) {
+		if (xml.name() != QLatin1String("SubscriptionReference")) {
+			xml.skipCurrentElement();
+			continue;
+		}
+		while (xml.readNextStartElement()) {
+			if (xml.name() == QLatin1String("Address"))
+				address = xml.readElementText().trimmed();
+			else
+				xml.skipCurrentElement();
+		}
 	}
+	/* Events may have been switched off while the request was out */
+	if (address.isEmpty() || !m_useEvents)
+		return;
+
+	m_subscriptionAddr = rewriteXAddrHost(address, host);
+	m_eventsActive = true;
+	m_movePollTimer.stop();
+	m_renewTimer.start();
+	ptz_info("receiving PTZ events from %s", QT_TO_UTF8(m_subscriptionAddr));
+	pullMessages();
+}
+
+void PTZOnvif::pullMessages()
+{
+	if (!m_eventsActive || m_pullRequest)
+		return;
+	QString msg;
+	QXmlStreamWriter s(&msg);
+	writeStartOnvifDocument(s);
+	s.writeNamespace(nsOnvifEvents, "tev");
+	s.writeStartElement(nsSoapEnvelope, "Envelope");
+	writeHeader(s, nsOnvifEvents + "/PullPointSubscription/PullMessagesRequest", m_subscriptionAddr);
+	s.writeStartElement(nsSoapEnvelope, "Body");
+	s.writeStartElement(nsOnvifEvents, "PullMessages");
+	/* Must stay below the transfer timeout in OnvifTransport::post() */
+	s.writeTextElement(nsOnvifEvents, "Timeout", "PT5S");
+	s.writeTextElement(nsOnvifEvents, "MessageLimit", "16");
+	s.writeEndElement(); // PullMessages
+	s.writeEndElement(); // Body
+	s.writeEndElement(); // Envelope
+	s.writeEndDocument();
+	m_pullStarted.start();
+	m_pullRequest = sendRequest(m_subscriptionAddr, msg.toUtf8(), false, true);
+}
+
+void PTZOnvif::handlePullMessagesResponse(QXmlStreamReader &xml)
+{
+	/* The payload of PTZ notifications varies between vendors, so the
+	 * notification is only used as a cue to fetch the real state. */
+	int count = 0;
+	while (xml.readNextStartElement()) {
+		if (xml.name() == QLatin1String("NotificationMessage"))
+			count++;
+		xml.skipCurrentElement();
+	}
+	if (count)
+		getStatus(true);
+}
+
+void PTZOnvif::renewSubscription()
+{
+	if (!m_eventsActive)
+		return;
+	QString msg;
+	QXmlStreamWriter s(&msg);
+	writeStartOnvifDocument(s);
+	s.writeNamespace(nsWsnBase, "wsnt");
+	s.writeStartElement(nsSoapEnvelope, "Envelope");
+	writeHeader(s, "http://docs.oasis-open.org/wsn/bw-2/SubscriptionManager/RenewRequest", m_subscriptionAddr);
+	s.writeStartElement(nsSoapEnvelope, "Body");
+	s.writeStartElement(nsWsnBase, "Renew");
+	s.writeTextElement(nsWsnBase, "TerminationTime", "PT60S");
+	s.writeEndElement(); // Renew
+	s.writeEndElement(); // Body
+	s.writeEndElement(); // Envelope
+	s.writeEndDocument();
+	m_renewRequest = sendRequest(m_subscriptionAddr, msg);
+}
+
+void PTZOnvif::stopEvents()
+{
+	/* The camera drops the subscription by itself once it stops being
+	 * renewed, so there is no need to Unsubscribe explicitly. */
+	m_eventsActive = false;
+	m_subscriptionAddr.clear();
+	m_renewTimer.stop();
+	m_pullTimer.stop();
+}
+
+/* Some cameras answer PullMessages straight away instead of holding it for
+ * the timeout; keep the next pull at least minPullIntervalMs after the last
+ * one started so that doesn't turn into a busy loop. */
+void PTZOnvif::schedulePull()
+{
+	qint64 wait = minPullIntervalMs - m_pullStarted.elapsed();
+	if (wait > 0)
+		m_pullTimer.start((int)wait);
+	else
+		pullMessages();
+}
+
+void PTZOnvif::trackMotion()
+{
+	if (m_eventsActive || m_movePollTimer.isActive() || m_PTZAddress.isEmpty())
+		return;
+	m_idlePolls = 0;
+	m_movePollTimer.start();
 }
 
 const QString nsOnvifImaging("http://www.onvif.org/ver20/imaging/wsdl"); //timg
@@ -703,16 +1133,57 @@ void PTZOnvif::getProfiles()
 	sendRequest(m_mediaXAddr, msg);
 }
 
-void PTZOnvif::requestFinished(QNetworkReply *reply)
+void PTZOnvif::requestFinished(quint64 id, QNetworkReply *reply)
 {
 	auto statusCodeV = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+	bool isMotion = m_motionRequests.remove(id);
+	bool isStatus = id == m_statusRequest;
+	if (isStatus)
+		m_statusRequest = 0;
 
-	m_isBusy = false;
-	if (reply->error() > 0) {
-		ptz_info("request error; message: %s, code: %i", QT_TO_UTF8(reply->errorString()), statusCodeV);
+	QByteArray body = reply->readAll();
+	/* A SOAP Fault normally comes with HTTP 500, but some cameras send it
+	 * with 200. Motion replies otherwise skip the parser, so this is the
+	 * only place a rejected move is noticed. */
+	QString faultReason;
+	bool fault = body.contains("Fault") && parseSoapFault(body, faultReason);
+
+	if (id == m_subscribeRequest || id == m_pullRequest || id == m_renewRequest) {
+		bool isPull = id == m_pullRequest;
+		if (isPull)
+			m_pullRequest = 0;
+		else if (id == m_subscribeRequest)
+			m_subscribeRequest = 0;
+		else
+			m_renewRequest = 0;
+		/* Event failures don't say anything about the PTZ service, so
+		 * they aren't counted as connection failures. Fall back to
+		 * polling and try again on the next reconnect. */
+		if (reply->error() > 0 || fault) {
+			ptz_info("PTZ events unavailable (%s); polling instead",
+				 QT_TO_UTF8((fault ? faultReason : reply->errorString())));
+			stopEvents();
+			trackMotion();
+			return;
+		}
+		handleResponse(body);
+		if (isPull)
+			schedulePull();
+		return;
+	}
+
+	if (fault)
+		ptz_info("SOAP fault: %s, code: %i", QT_TO_UTF8(faultReason), statusCodeV);
+
+	if (reply->error() > 0 || fault) {
+		if (!fault)
+			ptz_info("request error; message: %s, code: %i", QT_TO_UTF8(reply->errorString()),
+				 statusCodeV);
 		++m_consecutiveFailures;
 		if (m_consecutiveFailures >= 3 && isConnected())
 			setConnected(false);
+		if (!isConnected())
+			m_movePollTimer.stop();
 		/* If the very first request (GetSystemDateAndTime) fails we
 		 * still need to try GetCapabilities; otherwise the device
 		 * stays in a permanently un-initialized state. */
@@ -721,24 +1192,34 @@ void PTZOnvif::requestFinished(QNetworkReply *reply)
 		m_consecutiveFailures = 0;
 		if (!isConnected())
 			setConnected(true);
-		handleResponse(reply->readAll());
+		/* Motion replies carry no payload worth parsing */
+		if (!isMotion)
+			handleResponse(body);
+	}
+	if (isStatus && m_statusAgain) {
+		m_statusAgain = false;
+		if (isConnected())
+			getStatus();
 	}
-	do_update();
+	if (isMotion)
+		flushMotion();
 }
 
 PTZOnvif::PTZOnvif(OBSData config) : PTZDevice(config)
 {
-	// for digest authenticaton request
-	connect(&m_networkManager, &QNetworkAccessManager::authenticationRequired, this, &PTZOnvif::authRequired);
-	connect(&m_networkManager, &QNetworkAccessManager::finished, this, &PTZOnvif::requestFinished);
 	m_statusTimer.setInterval(5000);
 	connect(&m_statusTimer, &QTimer::timeout, this, [this]() {
-		/* When connected, keep position fresh; when disconnected and
-		 * we've already passed the initial connect, retry from
-		 * GetSystemDateAndTime so a rebooted camera that may have
-		 * changed profile tokens / service URLs re-initializes cleanly. */
+		/* Position updates are driven by trackMotion() and events, so
+		 * when connected this is only a liveness check every 30 s (not
+		 * needed at all while the event long-poll is running). When
+		 * disconnected and we've already passed the initial connect,
+		 * retry from GetSystemDateAndTime so a rebooted camera that may
+		 * have changed profile tokens / service URLs re-initializes
+		 * cleanly. */
+		m_statusTicks++;
 		if (isConnected()) {
-			getStatus();
+			if (!m_eventsActive && m_statusTicks % 6 == 0)
+				getStatus();
 		} else if (m_consecutiveFailures >= 3) {
 			m_capabilitiesRequested = false;
 			m_timeOffsetSecs = 0;
@@ -746,10 +1227,21 @@ PTZOnvif::PTZOnvif(OBSData config) : PTZDevice(config)
 		}
 	});
 	m_statusTimer.start();
+	m_movePollTimer.setInterval(250);
+	connect(&m_movePollTimer, &QTimer::timeout, this, [this]() { getStatus(); });
+	m_pullTimer.setSingleShot(true);
+	connect(&m_pullTimer, &QTimer::timeout, this, &PTZOnvif::pullMessages);
+	m_renewTimer.setInterval(45000);
+	connect(&m_renewTimer, &QTimer::timeout, this, &PTZOnvif::renewSubscription);
 	getDefaults(config);
 	update(config);
 }
 
+PTZOnvif::~PTZOnvif()
+{
+	OnvifTransport::get()->cancelAll(this);
+}
+
 QString PTZOnvif::description()
 {
 	return QString("ONVIF %1@%2:%3").arg(username, host, QString::number(port));
@@ -757,27 +1249,41 @@ QString PTZOnvif::description()
 
 void PTZOnvif::connectCamera()
 {
+	/* Any cached service addresses, profiles and clock offset stay in use
+	 * while the handshake below re-verifies them, so the camera can be
+	 * driven straight away instead of after four round trips. */
 	m_capabilitiesRequested = false;
-	m_timeOffsetSecs = 0;
 	m_pendingSetPresetSlot = -1;
 	m_consecutiveFailures = 0;
+	stopEvents();
 	getSystemDateAndTime();
 }
 
+void PTZOnvif::flushMotion()
+{
+	if (!m_motionPending || m_motionRequests.size() >= m_motionWindow)
+		return;
+
+	/* The speeds are read at send time, so whatever arrived while the
+	 * window was full collapses into a single request here. */
+	m_motionPending = false;
+	quint64 id;
+	if (pan_speed == 0.0 && tilt_speed == 0.0 && zoom_speed == 0.0)
+		id = stop();
+	else
+		id = continuousMove(pan_speed * m_speed_boost, tilt_speed * m_speed_boost, zoom_speed * m_speed_boost);
+	if (id)
+		m_motionRequests.insert(id);
+	trackMotion();
+}
+
 void PTZOnvif::do_update()
 {
 	if (pantilt_changed || zoom_changed) {
-		if (pan_speed == 0.0 && tilt_speed == 0.0 && zoom_speed == 0.0) {
-			pantilt_changed = false;
-			zoom_changed = false;
-			stop();
-		} else if (!m_isBusy) {
-			m_isBusy = true;
-			pantilt_changed = false;
-			zoom_changed = false;
-			continuousMove(pan_speed * m_speed_boost, tilt_speed * m_speed_boost,
-				       zoom_speed * m_speed_boost);
-		}
+		pantilt_changed = false;
+		zoom_changed = false;
+		m_motionPending = true;
+		flushMotion();
 	}
 	if (focus_changed) {
 		focus_changed = false;
@@ -796,21 +1302,25 @@ void PTZOnvif::set_autofocus(bool enabled)
 void PTZOnvif::pantilt_abs(double pan, double tilt)
 {
 	absoluteMove(pan, tilt, 0.0);
+	trackMotion();
 }
 
 void PTZOnvif::pantilt_rel(double pan, double tilt)
 {
 	relativeMove(pan, tilt, 0.0);
+	trackMotion();
 }
 
 void PTZOnvif::pantilt_home()
 {
 	goToHomePosition();
+	trackMotion();
 }
 
 void PTZOnvif::zoom_abs(double pos)
 {
 	absoluteMove(0.0, 0.0, pos);
+	trackMotion();
 }
 
 void PTZOnvif::getDefaults(OBSData config) const
@@ -820,24 +1330,119 @@ void PTZOnvif::getDefaults(OBSData config) const
 	obs_data_set_default_string(config, "username", "admin");
 	obs_data_set_default_string(config, "password", "");
 	obs_data_set_default_double(config, "speed_boost", 1.0);
+	obs_data_set_default_int(config, "motion_window", 1);
+	obs_data_set_default_bool(config, "use_events", false);
+	obs_data_set_default_int(config, "host_concurrency", 2);
+}
+
+QString PTZOnvif::connectionFingerprint() const
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QString("%1:%2|%3").arg(host).arg(port).arg(username).toUtf8());
+	return QString::fromLatin1(hash.result().toHex().left(16));
+}
+
+void PTZOnvif::loadCache(OBSData config)
+{
+	OBSDataAutoRelease cache = obs_data_get_obj(config, "onvif_cache");
+	if (!cache || connectionFingerprint() != obs_data_get_string(cache, "fingerprint"))
+		return;
+
+	m_PTZAddress = obs_data_get_string(cache, "ptz_xaddr");
+	m_mediaXAddr = obs_data_get_string(cache, "media_xaddr");
+	m_imagingXAddr = obs_data_get_string(cache, "imaging_xaddr");
+	m_eventsXAddr = obs_data_get_string(cache, "events_xaddr");
+	m_timeOffsetSecs = obs_data_get_int(cache, "time_offset");
+
+	m_mediaProfiles.clear();
+	OBSDataArrayAutoRelease profiles = obs_data_get_array(cache, "profiles");
+	for (size_t i = 0; i < obs_data_array_count(profiles); i++) {
+		OBSDataAutoRelease item = obs_data_array_item(profiles, i);
+		MediaProfile pro;
+		pro.token = obs_data_get_string(item, "token");
+		pro.name = obs_data_get_string(item, "name");
+		pro.videoSourceToken = obs_data_get_string(item, "video_source");
+		m_mediaProfiles.push_back(pro);
+	}
+	selectProfile();
+	ptz_debug("using cached service addresses; verifying in the background");
+}
+
+void PTZOnvif::saveCache(OBSData config) const
+{
+	if (m_PTZAddress.isEmpty())
+		return;
+
+	OBSDataAutoRelease cache = obs_data_create();
+	obs_data_set_string(cache, "fingerprint", QT_TO_UTF8(connectionFingerprint()));
+	obs_data_set_string(cache, "ptz_xaddr", QT_TO_UTF8(m_PTZAddress));
+	obs_data_set_string(cache, "media_xaddr", QT_TO_UTF8(m_mediaXAddr));
+	obs_data_set_string(cache, "imaging_xaddr", QT_TO_UTF8(m_imagingXAddr));
+	obs_data_set_string(cache, "events_xaddr", QT_TO_UTF8(m_eventsXAddr));
+	obs_data_set_int(cache, "time_offset", m_timeOffsetSecs);
+
+	OBSDataArrayAutoRelease profiles = obs_data_array_create();
+	for (const auto &p : m_mediaProfiles) {
+		OBSDataAutoRelease item = obs_data_create();
+		obs_data_set_string(item, "token", QT_TO_UTF8(p.token));
+		obs_data_set_string(item, "name", QT_TO_UTF8(p.name));
+		obs_data_set_string(item, "video_source", QT_TO_UTF8(p.videoSourceToken));
+		obs_data_array_push_back(profiles, item);
+	}
+	obs_data_set_array(cache, "profiles", profiles);
+	obs_data_set_obj(config, "onvif_cache", cache);
 }
 
 void PTZOnvif::update(OBSData config)
 {
 	PTZDevice::update(config);
+	QString oldFingerprint = connectionFingerprint();
+	QString oldPassword = password;
 	host = obs_data_get_string(config, "host");
 	port = (int)obs_data_get_int(config, "port");
 	username = obs_data_get_string(config, "username");
 	password = obs_data_get_string(config, "password");
+	bool connectionChanged = oldFingerprint != connectionFingerprint() || oldPassword != password;
 	m_speed_boost = obs_data_get_double(config, "speed_boost");
 	if (m_speed_boost <= 0.0)
 		m_speed_boost = 1.0;
+	m_motionWindow = std::max(1, (int)obs_data_get_int(config, "motion_window"));
+	m_useEvents = obs_data_get_bool(config, "use_events");
+	m_hostConcurrency = (int)obs_data_get_int(config, "host_concurrency");
+	OnvifTransport::get()->setHostLimit(this, host, m_hostConcurrency);
 	m_savedProfileToken = obs_data_get_string(config, "profile_token");
 	QString newWb = obs_data_get_string(config, "wb_mode");
 	if (newWb != m_wbMode) {
 		m_wbMode = newWb;
 		m_imagingDirty = true;
 	}
+
+	if (!m_initialized) {
+		m_initialized = true;
+		loadCache(config);
+	} else if (!connectionChanged) {
+		/* Only device options changed; there is nothing to rediscover */
+		selectProfile();
+		updateTemplates();
+		applyImagingIfPending();
+		if (!m_useEvents && m_eventsActive) {
+			stopEvents();
+			trackMotion();
+		} else if (m_useEvents && !m_eventsActive && !m_subscribeRequest && isConnected()) {
+			createPullPointSubscription();
+		}
+		return;
+	} else if (oldFingerprint != connectionFingerprint()) {
+		/* A different camera; what we learned about the old one is void */
+		m_PTZAddress.clear();
+		m_mediaXAddr.clear();
+		m_imagingXAddr.clear();
+		m_eventsXAddr.clear();
+		m_mediaProfiles.clear();
+		m_selectedMedia = MediaProfile();
+		m_timeOffsetSecs = 0;
+	}
+	updateTemplates();
 	connectCamera();
 }
 
@@ -849,8 +1454,12 @@ void PTZOnvif::save(OBSData config) const
 	obs_data_set_string(config, "username", QT_TO_UTF8(username));
 	obs_data_set_string(config, "password", QT_TO_UTF8(password));
 	obs_data_set_double(config, "speed_boost", m_speed_boost);
+	obs_data_set_int(config, "motion_window", m_motionWindow);
+	obs_data_set_bool(config, "use_events", m_useEvents);
+	obs_data_set_int(config, "host_concurrency", m_hostConcurrency);
 	obs_data_set_string(config, "profile_token", QT_TO_UTF8(m_selectedMedia.token));
 	obs_data_set_string(config, "wb_mode", QT_TO_UTF8(m_wbMode));
+	saveCache(config);
 }
 
 obs_properties_t *PTZOnvif::get_obs_properties()
@@ -866,6 +1475,9 @@ obs_properties_t *PTZOnvif::get_obs_properties()
 	obs_properties_add_text(config, "password", obs_module_text("PTZ.Device.Password"), OBS_TEXT_DEFAULT);
 	obs_properties_add_float_slider(config, "speed_boost", obs_module_text("PTZ.ONVIF.SpeedBoost"), 0.1, 10.0,
 					0.01);
+	obs_properties_add_int(config, "motion_window", obs_module_text("PTZ.ONVIF.MotionWindow"), 1, 8, 1);
+	obs_properties_add_bool(config, "use_events", obs_module_text("PTZ.ONVIF.UseEvents"));
+	obs_properties_add_int(config, "host_concurrency", obs_module_text("PTZ.ONVIF.HostConcurrency"), 1, 6, 1);
 	obs_property_t *prof = obs_properties_add_list(config, "profile_token",
 						       obs_module_text("PTZ.ONVIF.MediaProfile"), OBS_COMBO_TYPE_LIST,
 						       OBS_COMBO_FORMAT_STRING);
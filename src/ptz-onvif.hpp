@@ -8,17 +8,17 @@
 
 #include <QObject>
 #include "ptz-device.hpp"
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QtXml/QDomDocument>
+#include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <QObject>
 #include <QUuid>
-#include <QAuthenticator>
 #include <QDateTime>
 #include <QEventLoop>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QList>
+#include <QSet>
 
 class MediaProfile {
 public:
@@ -31,12 +31,13 @@ class PTZOnvif : public PTZDevice {
 	Q_OBJECT
 
 private:
-	bool m_isBusy = false;
 	QString host;
 	int port;
 	QString username;
 	QString password;
-	QNetworkAccessManager m_networkManager;
+	/* Requests go through the plugin-wide OnvifTransport and are
+	 * identified by the id it hands back; 0 means not sent. */
+	int m_hostConcurrency = 2;
 
 	QString m_mediaXAddr{""};
 	QString m_PTZAddress{""};
@@ -53,24 +54,76 @@ private:
 	double m_speed_boost = 1.0;
 
 	// SOAP/XML helpers
-	void writeHeader(QXmlStreamWriter &s, const QString action);
-
-	void sendRequest(QString host, QString req);
+	void writeHeader(QXmlStreamWriter &s, const QString action, const QString to);
+
+	/* Pre-rendered envelopes for ContinuousMove, Stop and GetStatus, which
+	 * are sent at joystick or poll rate. Only the values, nonce, timestamp
+	 * and digest get spliced in per request; see buildFastEnvelope(). */
+	QString m_tplProfileToken;
+	QByteArray m_tplSecurity;
+	QByteArray m_tplMoveBody;
+	QByteArray m_tplStopBody;
+	QByteArray m_tplStatusBody;
+	QByteArray m_passwordUtf8;
+	qint64 m_createdSecs = 0;
+	QByteArray m_created;
+	void updateTemplates();
+	QByteArray buildFastEnvelope(const QByteArray &action, const QByteArray &body);
+
+	quint64 sendRequest(QString host, QString req);
+	quint64 sendRequest(QString host, const QByteArray &req, bool urgent = false, bool longPoll = false);
 	void getSystemDateAndTime();
 	void getCapabilities();
 	void getProfiles();
 	void getPresets();
-	void getStatus();
-	void handleResponse(QString response);
-	void handleGetPresetsResponse(QDomDocument &doc);
-	void handleSetPresetResponse(QDomDocument &doc);
-	void handleGetCapabilitiesResponse(QDomNode node);
-	void handleGetProfilesResponse(QDomNode node);
-	void handleGetSystemDateAndTimeResponse(QDomNode node);
-	void handleGetStatusResponse(QDomNode node);
+	void getStatus(bool latest = false);
+	void handleResponse(const QByteArray &response);
+	void handleGetPresetsResponse(QXmlStreamReader &xml);
+	void handleSetPresetResponse(QXmlStreamReader &xml);
+	void handleGetCapabilitiesResponse(QXmlStreamReader &xml);
+	void handleGetProfilesResponse(QXmlStreamReader &xml);
+	void handleGetSystemDateAndTimeResponse(QXmlStreamReader &xml);
+	void handleGetStatusResponse(QXmlStreamReader &xml);
+	void handleCreatePullPointSubscriptionResponse(QXmlStreamReader &xml);
+	void handlePullMessagesResponse(QXmlStreamReader &xml);
 	void ensureCapabilitiesRequested();
+	void selectProfile();
+
+	/* Discovery results (service XAddrs, media profiles, clock offset) are
+	 * cached in the device config under "onvif_cache", tagged with a
+	 * fingerprint of the connection settings they were learned with. */
+	bool m_initialized = false;
+	QString connectionFingerprint() const;
+	void loadCache(OBSData config);
+	void saveCache(OBSData config) const;
 
 	QTimer m_statusTimer;
+	int m_statusTicks = 0;
+
+	/* Position tracking. With events enabled and supported, each PTZ
+	 * notification from the camera's PullPoint triggers one GetStatus.
+	 * Otherwise GetStatus is polled quickly after a move is commanded and
+	 * the poll stops again once the camera reports that it is idle. */
+	bool m_useEvents = false;
+	bool m_eventsActive = false;
+	QString m_eventsXAddr;
+	QString m_subscriptionAddr;
+	quint64 m_subscribeRequest = 0;
+	quint64 m_pullRequest = 0;
+	quint64 m_renewRequest = 0;
+	QTimer m_renewTimer;
+	QTimer m_pullTimer;
+	QElapsedTimer m_pullStarted;
+	static constexpr qint64 minPullIntervalMs = 500;
+	QTimer m_movePollTimer;
+	int m_idlePolls = 0;
+	void trackMotion();
+	void createPullPointSubscription();
+	void pullMessages();
+	void schedulePull();
+	void renewSubscription();
+	void stopEvents();
+
 	double m_position_pan = 0.0;
 	double m_position_tilt = 0.0;
 	double m_position_zoom = 0.0;
@@ -90,11 +143,24 @@ private:
 	 * regardless of whether time-sync succeeded or failed. */
 	bool m_capabilitiesRequested = false;
 
-	void genericMove(QString movetype, QString property, double pan, double tilt, double zoom);
-	void continuousMove(double x, double y, double z);
+	/* Motion channel. ContinuousMove/Stop requests are tracked apart from
+	 * management and telemetry requests so that a slow GetStatus or
+	 * GetPresets reply never holds up, or gets mistaken for, a motion
+	 * reply. At most m_motionWindow motion requests are in flight; any
+	 * input arriving while the window is full is coalesced and only the
+	 * latest speeds are sent once a slot frees up. */
+	QSet<quint64> m_motionRequests;
+	bool m_motionPending = false;
+	int m_motionWindow = 1;
+	quint64 m_statusRequest = 0;
+	bool m_statusAgain = false;
+	void flushMotion();
+
+	quint64 genericMove(QString movetype, QString property, double pan, double tilt, double zoom);
+	quint64 continuousMove(double x, double y, double z);
 	void absoluteMove(double x, double y, double z);
 	void relativeMove(double x, double y, double z);
-	void stop();
+	quint64 stop();
 	void goToHomePosition();
 
 	void imagingFocusMove(double speed);
@@ -107,13 +173,15 @@ private:
 	QString m_wbMode;
 	bool m_imagingDirty = false;
 
+	friend class OnvifTransport;
+	void requestFinished(quint64 id, QNetworkReply *reply);
+
 private slots:
 	void connectCamera();
-	void authRequired(QNetworkReply *reply, QAuthenticator *authenticator);
-	void requestFinished(QNetworkReply *reply);
 
 public:
 	PTZOnvif(OBSData config);
+	~PTZOnvif();
 	QString description() override;
 
 	void getDefaults(OBSData config) const override;
@@ -6,9 +6,26 @@
  * SPDX-License-Identifier: GPLv2
  */
 
+#include <cstring>
 #include "ptz-pelco.hpp"
 
-const QByteArray HOME = QByteArray::fromHex("0007002B");
+static const uint8_t HOME[4] = {0x00, 0x07, 0x00, 0x2B};
+
+/*
+ * Framing parameters for each protocol variant, indexed by use_pelco_d.
+ * Pelco-P: A0 addr-1 d1 d2 d3 d4 AF xor(bytes 0-6)
+ * Pelco-D: FF addr   d1 d2 d3 d4    sum(bytes 1-5) mod 256
+ */
+static const struct pelco_variant {
+	uint8_t sync;
+	uint8_t addr_offset;
+	bool has_etx;
+	size_t checksum_start;
+	bool checksum_xor;
+} pelco_variants[2] = {
+	{0xa0, 1, true, 0, true},
+	{0xff, 0, false, 1, false},
+};
 
 std::map<QString, PelcoUART *> PelcoUART::interfaces;
 
@@ -67,21 +84,24 @@ void PTZPelco::attach_interface(PelcoUART *new_iface)
 		connect(iface, &PelcoUART::receive, this, &PTZPelco::receive);
 }
 
-char PTZPelco::checkSum(QByteArray &data)
+size_t PTZPelco::buildFrame(PelcoFrame &frame, const uint8_t data[4]) const
 {
-	int sum = 0x00;
-	if (use_pelco_d) {
-		/* Pelco-D checksum */
-		for (char c : data)
-			sum += c;
-		sum = sum % 100;
-	} else {
-		/* Pelco-P checksum */
-		for (char c : data)
-			sum ^= c;
-	}
-
-	return sum & 0xff;
+	const pelco_variant &v = pelco_variants[use_pelco_d ? 1 : 0];
+	size_t len = 0;
+
+	frame[len++] = v.sync;
+	frame[len++] = (uint8_t)(address - v.addr_offset);
+	for (int i = 0; i < 4; i++)
+		frame[len++] = data[i];
+	if (v.has_etx)
+		frame[len++] = 0xaf;
+
+	uint8_t sum = 0;
+	for (size_t i = v.checksum_start; i < len; i++)
+		sum = v.checksum_xor ? (sum ^ frame[i]) : (uint8_t)(sum + frame[i]);
+	frame[len++] = sum;
+
+	return len;
 }
 
 void PTZPelco::receive(const QByteArray &msg)
@@ -90,55 +110,58 @@ void PTZPelco::receive(const QByteArray &msg)
 	if (!use_pelco_d)
 		addr++;
 	if (addr == this->address)
-		ptz_debug("Pelco received: %s", qPrintable(msg.toHex()));
+		ptz_debug_trace("Pelco received: %s", qPrintable(msg.toHex()));
 }
 
-void PTZPelco::send(const QByteArray &msg)
+void PTZPelco::send(const uint8_t data[4])
 {
-	QByteArray result = msg;
-	if (use_pelco_d) {
-		/* Pelco-D datagram */
-		result.prepend(address);
-		result.append(checkSum(result));
-		result.prepend(QByteArray::fromHex("ff"));
-	} else {
-		/* Pelco-P datagram */
-		result.prepend(address - 1);
-		result.prepend(QByteArray::fromHex("a0"));
-		result.append(QByteArray::fromHex("af"));
-		result.append(checkSum(result));
-	}
+	if (!iface)
+		return;
 
-	iface->send(result);
+	PelcoFrame frame;
+	size_t len = buildFrame(frame, data);
+	/* fromRawData() wraps the stack buffer without copying it */
+	QByteArray packet = QByteArray::fromRawData((const char *)frame.data(), len);
+	iface->send(packet);
 
-	ptz_debug("Pelco %c command send: %s", use_pelco_d ? 'D' : 'P', qPrintable(result.toHex(':')));
+	ptz_debug_trace("Pelco %c command send: %s", use_pelco_d ? 'D' : 'P', qPrintable(packet.toHex(':')));
 }
 
 void PTZPelco::send(const unsigned char data_1, const unsigned char data_2, const unsigned char data_3,
 		    const unsigned char data_4)
 {
-	QByteArray message;
-	message.resize(4);
-	message[0] = data_1;
-	message[1] = data_2;
-	message[2] = data_3;
-	message[3] = data_4;
-
-	send(message);
+	const uint8_t data[4] = {data_1, data_2, data_3, data_4};
+	send(data);
 }
 
+/* The speed setting commands are only sent when the value actually changes;
+ * most moves reuse the previous speed and don't need the extra frame. */
 void PTZPelco::focus_speed_set(double speed)
 {
-	send(0x00, 0x27, 0x00, abs(speed) * 0x33);
+	int value = (int)(std::abs(speed) * 0x33);
+	if (value == focus_speed_sent)
+		return;
+	focus_speed_sent = value;
+	send(0x00, 0x27, 0x00, value);
 }
 
 void PTZPelco::zoom_speed_set(double speed)
 {
-	send(0x00, 0x25, 0x00, abs(speed) * 0x33);
+	int value = (int)(std::abs(speed) * 0x33);
+	if (value == zoom_speed_sent)
+		return;
+	zoom_speed_sent = value;
+	send(0x00, 0x25, 0x00, value);
+}
+
+void PTZPelco::repeatMotion()
+{
+	send(motion_cmd);
 }
 
 PTZPelco::PTZPelco(OBSData data) : PTZDevice(data), iface(NULL)
 {
+	connect(&repeat_timer, &QTimer::timeout, this, &PTZPelco::repeatMotion);
 	getDefaults(data);
 	update(data);
 	ptz_debug("pelco device created");
@@ -153,6 +176,8 @@ void PTZPelco::getDefaults(OBSData config) const
 {
 	PTZDevice::getDefaults(config);
 	obs_data_set_default_bool(config, "use_pelco_d", false);
+	obs_data_set_default_int(config, "repeat_interval", 0);
+	obs_data_set_default_bool(config, "protocol_trace", false);
 }
 
 void PTZPelco::update(OBSData config)
@@ -161,6 +186,16 @@ void PTZPelco::update(OBSData config)
 	const char *uartt = obs_data_get_string(config, "port");
 	use_pelco_d = obs_data_get_bool(config, "use_pelco_d");
 	address = (unsigned int)obs_data_get_int(config, "address");
+	protocol_trace = obs_data_get_bool(config, "protocol_trace");
+	repeat_interval = (int)obs_data_get_int(config, "repeat_interval");
+	if (repeat_interval > 0)
+		repeat_timer.setInterval(repeat_interval);
+	else
+		repeat_timer.stop();
+
+	/* The camera may have been swapped or power cycled; resend speeds */
+	zoom_speed_sent = -1;
+	focus_speed_sent = -1;
 	if (!uartt)
 		return;
 
@@ -175,6 +210,8 @@ void PTZPelco::save(OBSData config) const
 	iface->save(config);
 	obs_data_set_int(config, "address", address);
 	obs_data_set_bool(config, "use_pelco_d", use_pelco_d);
+	obs_data_set_int(config, "repeat_interval", repeat_interval);
+	obs_data_set_bool(config, "protocol_trace", protocol_trace);
 }
 
 obs_properties_t *PTZPelco::get_obs_properties()
@@ -187,24 +224,28 @@ obs_properties_t *PTZPelco::get_obs_properties()
 	iface->addOBSProperties(config);
 	obs_properties_add_int(config, "address", obs_module_text("PTZ.Device.DeviceID"), 0, 15, 1);
 	obs_properties_add_bool(config, "use_pelco_d", obs_module_text("PTZ.Pelco.UsePelcoD"));
+	obs_property_t *r = obs_properties_add_int(config, "repeat_interval",
+						   obs_module_text("PTZ.Pelco.RepeatInterval"), 0, 1000, 10);
+	obs_property_int_set_suffix(r, " ms");
+	obs_properties_add_bool(config, "protocol_trace", obs_module_text("PTZ.Device.ProtocolTraceToLog"));
 
 	return ptz_props;
 }
 
 void PTZPelco::do_update()
 {
-	QByteArray msg = QByteArray::fromHex("00000000");
+	uint8_t msg[4] = {0, 0, 0, 0};
 	bool send_update = false;
 
 	if (pantilt_changed) {
 		pantilt_changed = false;
 		if (tilt_speed) {
 			msg[1] = msg[1] | (tilt_speed > 0.0 ? (1 << 3) : (1 << 4));
-			msg[3] = abs(tilt_speed) * 0x3f;
+			msg[3] = std::abs(tilt_speed) * 0x3f;
 		}
 		if (pan_speed) {
 			msg[1] = msg[1] | (pan_speed > 0.0 ? (1 << 1) : (1 << 2));
-			msg[2] = abs(pan_speed) * 0x3f;
+			msg[2] = std::abs(pan_speed) * 0x3f;
 		}
 		send_update = true;
 	}
@@ -231,8 +272,17 @@ void PTZPelco::do_update()
 	}
 
 	if (send_update) {
-		ptz_debug("pan %f, tilt %f, zoom %f, focus %f", pan_speed, tilt_speed, zoom_speed, focus_speed);
+		ptz_debug_trace("pan %f, tilt %f, zoom %f, focus %f", pan_speed, tilt_speed, zoom_speed, focus_speed);
 		send(msg);
+
+		bool moving = pan_speed || tilt_speed || zoom_speed || focus_speed;
+		if (moving && repeat_interval > 0) {
+			memcpy(motion_cmd, msg, sizeof(motion_cmd));
+			if (!repeat_timer.isActive())
+				repeat_timer.start(repeat_interval);
+		} else {
+			repeat_timer.stop();
+		}
 	}
 }
 
@@ -7,12 +7,14 @@
  */
 
 #pragma once
+#include <array>
 #include "ptz-device.hpp"
 #include <util/base.h>
 #include <QObject>
 #include <QDebug>
 #include <QStringListModel>
 #include <QtGlobal>
+#include <QTimer>
 #include "protocol-helpers.hpp"
 #include "uart-wrapper.hpp"
 
@@ -34,22 +36,42 @@ public:
 	static PelcoUART *get_interface(QString port_name);
 };
 
+/*
+ * Pelco frames are at most 8 bytes (Pelco-P) and are built on the stack.
+ * Pelco-D frames only use the first 7 bytes.
+ */
+typedef std::array<uint8_t, 8> PelcoFrame;
+
 class PTZPelco : public PTZDevice {
 private:
 	bool use_pelco_d = false; // Flag that Pelco-D is used instead of Pelco-P
+	bool protocol_trace = false;
 	PelcoUART *iface;
 	void attach_interface(PelcoUART *new_iface);
-	char checkSum(QByteArray &data);
+	size_t buildFrame(PelcoFrame &frame, const uint8_t data[4]) const;
+
+	/* Speed values last written with the extended set zoom/focus speed
+	 * commands. -1 means unknown, so the first move always sends it. */
+	int zoom_speed_sent = -1;
+	int focus_speed_sent = -1;
+
+	/* Many receivers stop moving if they don't see a motion command for a
+	 * while, so the last motion command is resent every repeat_interval
+	 * milliseconds until motion stops. 0 disables the repeat. */
+	int repeat_interval = 0;
+	uint8_t motion_cmd[4] = {0, 0, 0, 0};
+	QTimer repeat_timer;
 
 protected:
 	unsigned int address;
 
-	void send(const QByteArray &msg);
+	void send(const uint8_t data[4]);
 	void send(const unsigned char data_1, const unsigned char data_2, const unsigned char data_3,
 		  const unsigned char data_4);
 	void focus_speed_set(double speed);
 	void zoom_speed_set(double speed);
 	void receive(const QByteArray &msg);
+	void repeatMotion();
 
 public:
 	PTZPelco(OBSData data);
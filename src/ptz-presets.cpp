@@ -0,0 +1,134 @@
+/* Pan Tilt Zoom Controls - preset storage
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <algorithm>
+#include <qt-wrappers.hpp>
+#include "ptz-presets.hpp"
+
+void PTZPresetStore::reindexRows(int from)
+{
+	for (int row = from; row < count(); row++)
+		rows[presets[row].id] = row;
+}
+
+const PTZPreset *PTZPresetStore::find(size_t id) const
+{
+	int row = rowOf(id);
+	return row < 0 ? nullptr : &presets[row];
+}
+
+void PTZPresetStore::clear()
+{
+	presets.clear();
+	rows.clear();
+	tokens.clear();
+	names.clear();
+}
+
+bool PTZPresetStore::insert(int row, const PTZPreset &preset)
+{
+	if (contains(preset.id))
+		return false;
+	if (row < 0 || row > count())
+		row = count();
+	presets.insert(presets.begin() + row, preset);
+	reindexRows(row);
+	if (!preset.token.isEmpty())
+		tokens.insert(preset.token, preset.id);
+	if (!preset.name.isEmpty())
+		names.insert(preset.name, preset.id);
+	return true;
+}
+
+void PTZPresetStore::removeAt(int row)
+{
+	if (row < 0 || row >= count())
+		return;
+	const PTZPreset &p = presets[row];
+	rows.remove(p.id);
+	if (tokens.value(p.token) == p.id)
+		tokens.remove(p.token);
+	if (names.value(p.name) == p.id)
+		names.remove(p.name);
+	presets.erase(presets.begin() + row);
+	reindexRows(row);
+}
+
+void PTZPresetStore::move(int from, int to)
+{
+	if (from < 0 || from >= count() || to < 0 || to >= count() || from == to)
+		return;
+	PTZPreset p = std::move(presets[from]);
+	presets.erase(presets.begin() + from);
+	presets.insert(presets.begin() + to, std::move(p));
+	reindexRows(std::min(from, to));
+}
+
+void PTZPresetStore::setName(size_t id, const QString &name)
+{
+	int row = rowOf(id);
+	if (row < 0)
+		return;
+	PTZPreset &p = presets[row];
+	if (names.value(p.name) == id)
+		names.remove(p.name);
+	p.name = name;
+	if (!name.isEmpty())
+		names.insert(name, id);
+}
+
+void PTZPresetStore::setToken(size_t id, const QString &token)
+{
+	int row = rowOf(id);
+	if (row < 0)
+		return;
+	PTZPreset &p = presets[row];
+	if (tokens.value(p.token) == id)
+		tokens.remove(p.token);
+	p.token = token;
+	if (!token.isEmpty())
+		tokens.insert(token, id);
+}
+
+void PTZPresetStore::load(obs_data_array_t *array)
+{
+	clear();
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		OBSDataAutoRelease item = obs_data_array_item(array, i);
+		PTZPreset p;
+		p.id = obs_data_get_int(item, "id");
+		p.name = obs_data_get_string(item, "name");
+		p.token = obs_data_get_string(item, "token");
+		p.hasPosition = obs_data_has_user_value(item, "pan");
+		if (p.hasPosition) {
+			p.pan = obs_data_get_double(item, "pan");
+			p.tilt = obs_data_get_double(item, "tilt");
+			p.zoom = obs_data_get_double(item, "zoom");
+			p.focus = obs_data_get_double(item, "focus");
+		}
+		insert(-1, p);
+	}
+}
+
+void PTZPresetStore::save(obs_data_array_t *array) const
+{
+	for (const PTZPreset &p : presets) {
+		OBSDataAutoRelease data = obs_data_create();
+		obs_data_set_int(data, "id", p.id);
+		if (!p.name.isEmpty())
+			obs_data_set_string(data, "name", QT_TO_UTF8(p.name));
+		if (!p.token.isEmpty())
+			obs_data_set_string(data, "token", QT_TO_UTF8(p.token));
+		if (p.hasPosition) {
+			obs_data_set_double(data, "pan", p.pan);
+			obs_data_set_double(data, "tilt", p.tilt);
+			obs_data_set_double(data, "zoom", p.zoom);
+			obs_data_set_double(data, "focus", p.focus);
+		}
+		obs_data_array_push_back(array, data);
+	}
+}
@@ -0,0 +1,59 @@
+/* Pan Tilt Zoom Controls - preset storage
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <vector>
+#include <obs.hpp>
+
+struct PTZPreset {
+	size_t id = 0;
+	QString name;
+	/* Camera assigned identifier (ONVIF PresetToken); empty if none */
+	QString token;
+	/* Position recorded by drivers that store presets locally */
+	bool hasPosition = false;
+	double pan = 0;
+	double tilt = 0;
+	double zoom = 0;
+	double focus = 0;
+};
+
+/*
+ * Presets of one device, kept in display order in a flat vector. The id,
+ * token and name hashes make lookups O(1) however many presets the camera
+ * has. Only the row index needs rebuilding when presets are inserted,
+ * removed or reordered, which is a user action and rare.
+ */
+class PTZPresetStore {
+	std::vector<PTZPreset> presets;
+	QHash<size_t, int> rows;
+	QHash<QString, size_t> tokens;
+	QHash<QString, size_t> names;
+
+	void reindexRows(int from = 0);
+
+public:
+	int count() const { return (int)presets.size(); }
+	bool contains(size_t id) const { return rows.contains(id); }
+	int rowOf(size_t id) const { return rows.value(id, -1); }
+	const PTZPreset &at(int row) const { return presets[row]; }
+	const PTZPreset *find(size_t id) const;
+	int findByToken(const QString &token) const { return tokens.contains(token) ? (int)tokens[token] : -1; }
+	int findByName(const QString &name) const { return names.contains(name) ? (int)names[name] : -1; }
+
+	void clear();
+	bool insert(int row, const PTZPreset &preset);
+	void removeAt(int row);
+	void move(int from, int to);
+	void setName(size_t id, const QString &name);
+	void setToken(size_t id, const QString &token);
+
+	void load(obs_data_array_t *array);
+	void save(obs_data_array_t *array) const;
+};
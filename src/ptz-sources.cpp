@@ -0,0 +1,168 @@
+/* Pan Tilt Zoom Controls - index of OBS source names
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include "ptz-sources.hpp"
+#include "ptz.h"
+
+PTZSourceIndex ptzSourceIndex;
+
+/* Only inputs, the same set obs_enum_sources() returns; the global signals
+ * also fire for scenes, filters and transitions. */
+static bool is_indexed(obs_source_t *src)
+{
+	return src && obs_source_get_type(src) == OBS_SOURCE_TYPE_INPUT;
+}
+
+void PTZSourceIndex::source_create_cb(void *data, calldata_t *cd)
+{
+	auto index = static_cast<PTZSourceIndex *>(data);
+	auto src = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	if (!is_indexed(src))
+		return;
+	std::lock_guard<std::mutex> guard(index->lock);
+	index->addSource(obs_source_get_name(src));
+}
+
+void PTZSourceIndex::source_remove_cb(void *data, calldata_t *cd)
+{
+	auto index = static_cast<PTZSourceIndex *>(data);
+	auto src = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	if (!is_indexed(src))
+		return;
+	std::lock_guard<std::mutex> guard(index->lock);
+	index->removeSource(obs_source_get_name(src));
+}
+
+void PTZSourceIndex::source_rename_cb(void *data, calldata_t *cd)
+{
+	auto index = static_cast<PTZSourceIndex *>(data);
+	auto src = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	if (!is_indexed(src))
+		return;
+	std::lock_guard<std::mutex> guard(index->lock);
+	index->removeSource(calldata_string(cd, "prev_name"));
+	index->addSource(calldata_string(cd, "new_name"));
+}
+
+void PTZSourceIndex::addSource(const QString &name)
+{
+	if (name.isEmpty())
+		return;
+	sources.insert(name);
+	if (!assigned.contains(name))
+		unassigned.insert(name);
+}
+
+void PTZSourceIndex::removeSource(const QString &name)
+{
+	sources.remove(name);
+	unassigned.erase(name);
+}
+
+/* Connect the signals and pick up any sources that already exist */
+void PTZSourceIndex::load()
+{
+	if (loaded)
+		return;
+	loaded = true;
+
+	signal_handler_t *sh = obs_get_signal_handler();
+	signal_handler_connect(sh, "source_create", source_create_cb, this);
+	signal_handler_connect(sh, "source_remove", source_remove_cb, this);
+	signal_handler_connect(sh, "source_destroy", source_remove_cb, this);
+	signal_handler_connect(sh, "source_rename", source_rename_cb, this);
+
+	/* Not under the lock; obs_enum_sources() holds its own mutex */
+	auto src_cb = [](void *data, obs_source_t *src) {
+		if (is_indexed(src))
+			static_cast<QStringList *>(data)->append(obs_source_get_name(src));
+		return true;
+	};
+	QStringList names;
+	obs_enum_sources(src_cb, &names);
+
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto &name : names)
+		addSource(name);
+}
+
+void PTZSourceIndex::unload()
+{
+	if (!loaded)
+		return;
+	loaded = false;
+
+	signal_handler_t *sh = obs_get_signal_handler();
+	signal_handler_disconnect(sh, "source_create", source_create_cb, this);
+	signal_handler_disconnect(sh, "source_remove", source_remove_cb, this);
+	signal_handler_disconnect(sh, "source_destroy", source_remove_cb, this);
+	signal_handler_disconnect(sh, "source_rename", source_rename_cb, this);
+
+	std::lock_guard<std::mutex> guard(lock);
+	sources.clear();
+	assigned.clear();
+	unassigned.clear();
+}
+
+void PTZActiveSources::collect(obs_source_t *src)
+{
+	clear();
+	if (!src)
+		return;
+	scene = obs_source_get_name(src);
+	ordered.append(scene);
+	names.insert(scene);
+
+	auto active_src_cb = [](obs_source_t *, obs_source_t *child, void *data) {
+		auto active = static_cast<PTZActiveSources *>(data);
+		QString name = obs_source_get_name(child);
+		if (!active->names.contains(name)) {
+			active->names.insert(name);
+			active->ordered.append(name);
+		}
+	};
+	obs_source_enum_active_sources(src, active_src_cb, this);
+}
+
+void PTZActiveSources::clear()
+{
+	scene.clear();
+	ordered.clear();
+	names.clear();
+}
+
+bool PTZSourceIndex::contains(const QString &name) const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return sources.contains(name);
+}
+
+/* Sorted names of the sources not claimed by any PTZ device */
+QStringList PTZSourceIndex::unassignedSources() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	QStringList list;
+	list.reserve((qsizetype)unassigned.size());
+	for (auto &name : unassigned)
+		list.append(name);
+	return list;
+}
+
+void PTZSourceIndex::assign(const QString &name)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	assigned.insert(name);
+	unassigned.erase(name);
+}
+
+void PTZSourceIndex::unassign(const QString &name)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	assigned.remove(name);
+	if (sources.contains(name))
+		unassigned.insert(name);
+}
@@ -0,0 +1,67 @@
+/* Pan Tilt Zoom Controls - index of OBS source names
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <mutex>
+#include <set>
+#include <obs.hpp>
+
+/*
+ * Names of all non-scene sources, kept up to date from the global
+ * source_create/remove/destroy/rename signals so that device property
+ * pages don't have to enumerate every source in the scene collection.
+ * Names claimed by a PTZ device are tracked as well, and the sorted set
+ * of unclaimed names is updated incrementally as either side changes.
+ *
+ * Signals can arrive on any thread, so all access is under a mutex.
+ */
+class PTZSourceIndex {
+private:
+	mutable std::mutex lock;
+	QSet<QString> sources;
+	QSet<QString> assigned;
+	std::set<QString> unassigned;
+	bool loaded = false;
+
+	void addSource(const QString &name);
+	void removeSource(const QString &name);
+
+	static void source_create_cb(void *data, calldata_t *cd);
+	static void source_remove_cb(void *data, calldata_t *cd);
+	static void source_rename_cb(void *data, calldata_t *cd);
+
+public:
+	void load();
+	void unload();
+
+	bool contains(const QString &name) const;
+	QStringList unassignedSources() const;
+
+	/* Called by PTZListModel as devices are added, removed and renamed */
+	void assign(const QString &name);
+	void unassign(const QString &name);
+};
+
+extern PTZSourceIndex ptzSourceIndex;
+
+/*
+ * Names of the sources active in one scene, collected with a single walk
+ * of the scene so that the live/preview state of every device can be
+ * resolved by hash lookup. The scene itself is the first entry.
+ */
+struct PTZActiveSources {
+	QString scene;
+	QStringList ordered;
+	QSet<QString> names;
+
+	void collect(obs_source_t *scene);
+	void clear();
+	bool contains(const QString &name) const { return names.contains(name); }
+};
@@ -0,0 +1,550 @@
+/* Pan Tilt Zoom USB UVC control backends
+ *
+ * Copyright 2025 Fabio Ferrari <fabio.ferrar@gmail.com>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+struct PtzUsbCamLimits {
+	long pan = 0;
+	long tilt = 0;
+	long zoom = 0;
+	long focus = 0;
+	// long temperature = 0;
+};
+
+struct PtzUsbCamPos {
+	double pan = 0;
+	double tilt = 0;
+	double zoom = 0;
+	bool focusAuto = true;
+	double focus = 0;
+	// bool whitebalAuto = true;
+	// double temperature = 0;
+};
+
+class PTZControl {
+protected:
+	std::string device_path;
+	PtzUsbCamLimits min, max;
+	PtzUsbCamPos now_pos;
+
+public:
+	virtual ~PTZControl() {}
+	virtual bool internal_pan(long value) = 0;
+	bool pan(double value)
+	{
+		now_pos.pan = std::clamp(value, -1.0, 1.0);
+		long pan = std::clamp(static_cast<long>(now_pos.pan * max.pan), min.pan, max.pan);
+		return internal_pan(pan);
+	}
+	double getPan() const { return now_pos.pan; }
+	virtual bool internal_tilt(long value) = 0;
+	bool tilt(double value)
+	{
+		now_pos.tilt = std::clamp(value, -1.0, 1.0);
+		long tilt = std::clamp(static_cast<long>(now_pos.tilt * max.tilt), min.tilt, max.tilt);
+		return internal_tilt(tilt);
+	}
+	double getTilt() const { return now_pos.tilt; }
+	virtual bool internal_zoom(long value) = 0;
+	bool zoom(double value)
+	{
+		now_pos.zoom = std::clamp(value, 0.0, 1.0);
+		long zoom = std::clamp(static_cast<long>(now_pos.zoom * max.zoom), min.zoom, max.zoom);
+		return internal_zoom(zoom);
+	}
+	double getZoom() const { return now_pos.zoom; }
+	virtual bool internal_focus(bool auto_focus, long value) = 0;
+	bool focus(double value)
+	{
+		now_pos.focus = std::clamp(value, 0.0, 1.0);
+		long focus = std::clamp(static_cast<long>(now_pos.focus * max.focus), min.focus, max.focus);
+		return internal_focus(false, focus);
+	}
+	double getFocus() const { return now_pos.focus; }
+	bool setAutoFocus(bool enabled)
+	{
+		long focus = std::clamp(static_cast<long>(now_pos.focus * max.focus), min.focus, max.focus);
+		return internal_focus(enabled, focus);
+	}
+	struct PtzUsbCamPos getPosition() const { return now_pos; }
+	std::string getDevicePath() { return device_path; }
+	virtual bool isValid() const = 0;
+
+	/* Optional native motion controls. Speeds are normalized to -1..1 and
+	 * relative moves are fractions of the absolute range. A backend that
+	 * lacks them leaves has*() false, and continuous motion is emulated
+	 * by stepping the absolute position from the tick callback. */
+	virtual bool hasPanTiltSpeed() const { return false; }
+	virtual bool panTiltSpeed(double pan, double tilt)
+	{
+		(void)pan;
+		(void)tilt;
+		return false;
+	}
+	virtual bool hasZoomSpeed() const { return false; }
+	virtual bool zoomSpeed(double speed)
+	{
+		(void)speed;
+		return false;
+	}
+	virtual bool hasPanTiltRelative() const { return false; }
+	virtual bool internal_pantilt_rel(long pan, long tilt)
+	{
+		(void)pan;
+		(void)tilt;
+		return false;
+	}
+	bool pantiltRelative(double pan, double tilt)
+	{
+		double new_pan = std::clamp(now_pos.pan + pan, -1.0, 1.0);
+		double new_tilt = std::clamp(now_pos.tilt + tilt, -1.0, 1.0);
+		long dpan = std::lround((new_pan - now_pos.pan) * max.pan);
+		long dtilt = std::lround((new_tilt - now_pos.tilt) * max.tilt);
+		now_pos.pan = new_pan;
+		now_pos.tilt = new_tilt;
+		return internal_pantilt_rel(dpan, dtilt);
+	}
+	/* Pick up positions the backend learned about asynchronously, such as
+	 * changes made by another application. Called from the tick. */
+	virtual void sync() {}
+};
+
+#ifdef __linux__
+#include <linux/v4l2-controls.h>
+#include <linux/videodev2.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <util/base.h>
+
+/*
+ * System call layer used by V4L2Control. Everything V4L2Control does to the
+ * device goes through here, so a fake camera can be substituted by passing a
+ * different V4L2Io to the constructor.
+ */
+class V4L2Io {
+public:
+	virtual ~V4L2Io() {}
+	virtual int open(const char *path, int flags) { return ::open(path, flags); }
+	virtual int close(int fd) { return ::close(fd); }
+	virtual int ioctl(int fd, unsigned long request, void *arg) { return ::ioctl(fd, request, arg); }
+	virtual int poll(struct pollfd *fds, nfds_t nfds, int timeout) { return ::poll(fds, nfds, timeout); }
+
+	static V4L2Io &system()
+	{
+		static V4L2Io io;
+		return io;
+	}
+};
+
+/*
+ * Control transfers on some UVC firmware take tens of milliseconds, which is
+ * far too long to block the OBS tick thread for. Targets are handed to a
+ * per-device writer thread through a mailbox holding only the latest value
+ * for each control; a target replaced before the thread got to it is never
+ * sent. Relative moves are the exception and accumulate instead.
+ *
+ * The writer sends everything pending as one VIDIOC_S_EXT_CTRLS, and also
+ * listens for V4L2_EVENT_CTRL so that moves made by other applications show
+ * up in the cached position.
+ */
+class V4L2Control : public PTZControl {
+private:
+	enum Ctrl { CtrlPan, CtrlTilt, CtrlZoom, CtrlPanSpeed, CtrlTiltSpeed, CtrlZoomSpeed, CtrlPanRel, CtrlTiltRel, CtrlCount };
+	static constexpr unsigned int ctrl_ids[CtrlCount] = {
+		V4L2_CID_PAN_ABSOLUTE, V4L2_CID_TILT_ABSOLUTE, V4L2_CID_ZOOM_ABSOLUTE, V4L2_CID_PAN_SPEED,
+		V4L2_CID_TILT_SPEED,   V4L2_CID_ZOOM_CONTINUOUS, V4L2_CID_PAN_RELATIVE, V4L2_CID_TILT_RELATIVE,
+	};
+	struct Mailbox {
+		long value[CtrlCount] = {};
+		bool pending[CtrlCount] = {};
+		bool focus_pending = false;
+		bool focus_auto = false;
+		long focus = 0;
+		bool quit = false;
+	};
+
+	V4L2Io &io;
+	int fd;
+	int wake_fd = -1;
+	std::atomic<bool> lost{false};
+	std::thread writer;
+	std::mutex lock;
+	Mailbox mailbox;
+	bool has_ctrl[CtrlCount] = {};
+	long speed_max[CtrlCount] = {};
+	long last_speed[CtrlCount] = {};
+	bool ext_ctrls_ok = true;
+	/* Writer thread only */
+	int focus_auto_state = -1;
+
+	/* Positions reported by the device, handed from the writer to sync() */
+	std::mutex observed_lock;
+	std::atomic<bool> observed_dirty{false};
+	PtzUsbCamPos observed;
+	bool observed_axis[4] = {};
+
+	int query_ctrl(unsigned int i, long *pmin, long *pmax)
+	{
+		if (fd == -1)
+			return -1;
+		struct v4l2_queryctrl queryctrl = {};
+		queryctrl.id = i;
+		if (io.ioctl(fd, VIDIOC_QUERYCTRL, &queryctrl) == -1 || (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED))
+			return -1;
+		*pmin = queryctrl.minimum;
+		*pmax = queryctrl.maximum;
+		return 0;
+	}
+	int set_ctrl(unsigned int i, long value)
+	{
+		if (fd == -1)
+			return false;
+		struct v4l2_control control = {};
+		control.id = i;
+		control.value = value;
+		if (io.ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
+			blog(LOG_ERROR, "Failed to set PTZ %d value", i);
+			/* Unplugged; make the device get looked up again */
+			if (errno == ENODEV)
+				lost = true;
+			return false;
+		}
+		return true;
+	}
+	int get_ctrl(unsigned int i)
+	{
+		if (fd == -1)
+			return 0;
+		struct v4l2_control control = {};
+		control.id = i;
+		if (io.ioctl(fd, VIDIOC_G_CTRL, &control) == -1) {
+			blog(LOG_ERROR, "VIDIOC_G_CTRL failed for axis %d", i);
+			return 0;
+		}
+		return control.value;
+	}
+
+	bool post(Ctrl ctrl, long value)
+	{
+		if (!isValid() || !has_ctrl[ctrl])
+			return false;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (ctrl == CtrlPanRel || ctrl == CtrlTiltRel)
+				mailbox.value[ctrl] += value;
+			else
+				mailbox.value[ctrl] = value;
+			mailbox.pending[ctrl] = true;
+		}
+		kick();
+		return true;
+	}
+	void kick()
+	{
+		uint64_t one = 1;
+		if (write(wake_fd, &one, sizeof(one)) < 0)
+			blog(LOG_ERROR, "Failed to wake V4L2 writer: %s", strerror(errno));
+	}
+	/* Scale a normalized speed to the control's range; never round a
+	 * requested move down to a stop */
+	long scale_speed(Ctrl ctrl, double speed)
+	{
+		long value = std::lround(std::clamp(speed, -1.0, 1.0) * speed_max[ctrl]);
+		if (value == 0 && speed != 0.0)
+			value = speed > 0 ? 1 : -1;
+		return value;
+	}
+
+	void write_focus(bool auto_focus, long value)
+	{
+		if (auto_focus) {
+			if (set_ctrl(V4L2_CID_FOCUS_AUTO, 1))
+				focus_auto_state = 1;
+			return;
+		}
+		if (focus_auto_state != 0) {
+			set_ctrl(V4L2_CID_FOCUS_AUTO, 0);
+			focus_auto_state = 0;
+		}
+		set_ctrl(V4L2_CID_FOCUS_ABSOLUTE, value);
+	}
+
+	void write_ctrls(const Mailbox &work)
+	{
+		struct v4l2_ext_control ctrls[CtrlCount] = {};
+		unsigned int count = 0;
+		for (int i = 0; i < CtrlCount; i++) {
+			if (!work.pending[i])
+				continue;
+			ctrls[count].id = ctrl_ids[i];
+			ctrls[count].value = work.value[i];
+			count++;
+		}
+		if (count == 0)
+			return;
+
+		if (ext_ctrls_ok) {
+			struct v4l2_ext_controls ext = {};
+			ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+			ext.count = count;
+			ext.controls = ctrls;
+			if (io.ioctl(fd, VIDIOC_S_EXT_CTRLS, &ext) == 0)
+				return;
+			if (errno == ENODEV) {
+				lost = true;
+				return;
+			}
+			/* error_idx == count means validation failed before anything
+			 * was applied; otherwise only the controls up to it are done */
+			unsigned int done = ext.error_idx < count ? ext.error_idx : 0;
+			if (errno == ENOTTY) {
+				blog(LOG_INFO, "V4L2 device %s has no extended controls", device_path.c_str());
+				ext_ctrls_ok = false;
+				done = 0;
+			}
+			for (unsigned int i = done; i < count; i++)
+				set_ctrl(ctrls[i].id, ctrls[i].value);
+			return;
+		}
+		for (unsigned int i = 0; i < count; i++)
+			set_ctrl(ctrls[i].id, ctrls[i].value);
+	}
+
+	void publish(int axis, long value)
+	{
+		std::lock_guard<std::mutex> guard(observed_lock);
+		switch (axis) {
+		case CtrlPan:
+			observed.pan = max.pan ? static_cast<double>(value) / max.pan : 0.0;
+			break;
+		case CtrlTilt:
+			observed.tilt = max.tilt ? static_cast<double>(value) / max.tilt : 0.0;
+			break;
+		case CtrlZoom:
+			observed.zoom = max.zoom ? static_cast<double>(value) / max.zoom : 0.0;
+			break;
+		default:
+			observed.focus = max.focus ? static_cast<double>(value) / max.focus : 0.0;
+			break;
+		}
+		observed_axis[std::min(axis, 3)] = true;
+		observed_dirty = true;
+	}
+
+	void read_events()
+	{
+		struct v4l2_event ev = {};
+		while (io.ioctl(fd, VIDIOC_DQEVENT, &ev) == 0) {
+			if (ev.type != V4L2_EVENT_CTRL || !(ev.u.ctrl.changes & V4L2_EVENT_CTRL_CH_VALUE))
+				continue;
+			switch (ev.id) {
+			case V4L2_CID_PAN_ABSOLUTE:
+				publish(CtrlPan, ev.u.ctrl.value);
+				break;
+			case V4L2_CID_TILT_ABSOLUTE:
+				publish(CtrlTilt, ev.u.ctrl.value);
+				break;
+			case V4L2_CID_ZOOM_ABSOLUTE:
+				publish(CtrlZoom, ev.u.ctrl.value);
+				break;
+			case V4L2_CID_FOCUS_ABSOLUTE:
+				publish(CtrlCount, ev.u.ctrl.value);
+				break;
+			}
+		}
+	}
+
+	void subscribe_events()
+	{
+		for (unsigned int id : {V4L2_CID_PAN_ABSOLUTE, V4L2_CID_TILT_ABSOLUTE, V4L2_CID_ZOOM_ABSOLUTE,
+					V4L2_CID_FOCUS_ABSOLUTE}) {
+			struct v4l2_event_subscription sub = {};
+			sub.type = V4L2_EVENT_CTRL;
+			sub.id = id;
+			io.ioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub);
+		}
+	}
+
+	void writer_loop()
+	{
+		focus_auto_state = get_ctrl(V4L2_CID_FOCUS_AUTO);
+		struct pollfd fds[2] = {{wake_fd, POLLIN, 0}, {fd, POLLPRI, 0}};
+		for (;;) {
+			if (io.poll(fds, 2, -1) < 0) {
+				if (errno == EINTR)
+					continue;
+				blog(LOG_ERROR, "V4L2 writer poll failed: %s", strerror(errno));
+				return;
+			}
+			if (fds[1].revents & POLLPRI)
+				read_events();
+			/* Some drivers flag errors on an fd that isn't streaming;
+			 * stop watching it, unplug is still caught by ENODEV */
+			if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL))
+				fds[1].fd = -1;
+			if (!(fds[0].revents & POLLIN))
+				continue;
+			uint64_t count;
+			if (read(wake_fd, &count, sizeof(count)) < 0)
+				continue;
+
+			Mailbox work;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if (mailbox.quit)
+					return;
+				work = mailbox;
+				mailbox = Mailbox();
+			}
+			write_ctrls(work);
+			if (work.focus_pending)
+				write_focus(work.focus_auto, work.focus);
+
+			/* Position isn't tracked while moving at a speed, so read it
+			 * back once the axis stops */
+			if ((work.pending[CtrlPanSpeed] && work.value[CtrlPanSpeed] == 0) ||
+			    (work.pending[CtrlTiltSpeed] && work.value[CtrlTiltSpeed] == 0)) {
+				publish(CtrlPan, get_ctrl(V4L2_CID_PAN_ABSOLUTE));
+				publish(CtrlTilt, get_ctrl(V4L2_CID_TILT_ABSOLUTE));
+			}
+			if (work.pending[CtrlZoomSpeed] && work.value[CtrlZoomSpeed] == 0)
+				publish(CtrlZoom, get_ctrl(V4L2_CID_ZOOM_ABSOLUTE));
+		}
+	}
+
+public:
+	V4L2Control(const std::string &device, V4L2Io &io_ = V4L2Io::system()) : io(io_)
+	{
+		device_path = device;
+		fd = io.open(device_path.c_str(), O_RDWR | O_NONBLOCK);
+		if (fd == -1) {
+			blog(LOG_ERROR, "Failed to open V4L2 device: %s", device_path.c_str());
+			return;
+		}
+		has_ctrl[CtrlPan] = query_ctrl(V4L2_CID_PAN_ABSOLUTE, &min.pan, &max.pan) == 0;
+		has_ctrl[CtrlTilt] = query_ctrl(V4L2_CID_TILT_ABSOLUTE, &min.tilt, &max.tilt) == 0;
+		has_ctrl[CtrlZoom] = query_ctrl(V4L2_CID_ZOOM_ABSOLUTE, &min.zoom, &max.zoom) == 0;
+		if (query_ctrl(V4L2_CID_FOCUS_ABSOLUTE, &min.focus, &max.focus) != 0)
+			blog(LOG_INFO, "V4L2 device %s has no absolute focus", device_path.c_str());
+		for (int i = CtrlPanSpeed; i < CtrlCount; i++) {
+			long lo = 0, hi = 0;
+			has_ctrl[i] = query_ctrl(ctrl_ids[i], &lo, &hi) == 0 && hi > 0;
+			speed_max[i] = std::min(hi, -lo);
+		}
+		/* Speed controls only help when both directions are available */
+		for (int i = CtrlPanSpeed; i <= CtrlZoomSpeed; i++)
+			has_ctrl[i] = has_ctrl[i] && speed_max[i] > 0;
+		blog(LOG_INFO, "V4L2 device %s: pan/tilt speed %s, zoom speed %s, relative pan/tilt %s",
+		     device_path.c_str(), hasPanTiltSpeed() ? "yes" : "no", hasZoomSpeed() ? "yes" : "no",
+		     hasPanTiltRelative() ? "yes" : "no");
+
+		now_pos.pan = static_cast<double>(get_ctrl(V4L2_CID_PAN_ABSOLUTE)) / max.pan;
+		now_pos.tilt = static_cast<double>(get_ctrl(V4L2_CID_TILT_ABSOLUTE)) / max.tilt;
+		now_pos.zoom = static_cast<double>(get_ctrl(V4L2_CID_ZOOM_ABSOLUTE)) / max.zoom;
+		now_pos.focus = static_cast<double>(get_ctrl(V4L2_CID_FOCUS_ABSOLUTE)) / max.focus;
+		now_pos.focusAuto = get_ctrl(V4L2_CID_FOCUS_AUTO);
+		subscribe_events();
+
+		wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (wake_fd == -1) {
+			blog(LOG_ERROR, "Failed to create V4L2 writer eventfd: %s", strerror(errno));
+			io.close(fd);
+			fd = -1;
+			return;
+		}
+		writer = std::thread(&V4L2Control::writer_loop, this);
+	}
+	bool internal_pan(long value) override { return post(CtrlPan, value); }
+	bool internal_tilt(long value) override { return post(CtrlTilt, value); }
+	bool internal_zoom(long value) override { return post(CtrlZoom, value); }
+	bool internal_focus(bool auto_focus, long value) override
+	{
+		if (!isValid())
+			return false;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			mailbox.focus_pending = true;
+			mailbox.focus_auto = auto_focus;
+			mailbox.focus = value;
+		}
+		kick();
+		return true;
+	}
+
+	bool hasPanTiltSpeed() const override { return has_ctrl[CtrlPanSpeed] && has_ctrl[CtrlTiltSpeed]; }
+	bool panTiltSpeed(double pan, double tilt) override
+	{
+		long p = scale_speed(CtrlPanSpeed, pan);
+		long t = scale_speed(CtrlTiltSpeed, tilt);
+		if (p == last_speed[CtrlPanSpeed] && t == last_speed[CtrlTiltSpeed])
+			return true;
+		last_speed[CtrlPanSpeed] = p;
+		last_speed[CtrlTiltSpeed] = t;
+		return post(CtrlPanSpeed, p) && post(CtrlTiltSpeed, t);
+	}
+	bool hasZoomSpeed() const override { return has_ctrl[CtrlZoomSpeed]; }
+	bool zoomSpeed(double speed) override
+	{
+		long z = scale_speed(CtrlZoomSpeed, speed);
+		if (z == last_speed[CtrlZoomSpeed])
+			return true;
+		last_speed[CtrlZoomSpeed] = z;
+		return post(CtrlZoomSpeed, z);
+	}
+	bool hasPanTiltRelative() const override { return has_ctrl[CtrlPanRel] && has_ctrl[CtrlTiltRel]; }
+	bool internal_pantilt_rel(long pan, long tilt) override
+	{
+		return (pan == 0 || post(CtrlPanRel, pan)) && (tilt == 0 || post(CtrlTiltRel, tilt));
+	}
+
+	void sync() override
+	{
+		if (!observed_dirty.exchange(false))
+			return;
+		std::lock_guard<std::mutex> guard(observed_lock);
+		if (observed_axis[CtrlPan])
+			now_pos.pan = observed.pan;
+		if (observed_axis[CtrlTilt])
+			now_pos.tilt = observed.tilt;
+		if (observed_axis[CtrlZoom])
+			now_pos.zoom = observed.zoom;
+		if (observed_axis[3])
+			now_pos.focus = observed.focus;
+		std::fill(std::begin(observed_axis), std::end(observed_axis), false);
+	}
+
+	~V4L2Control() override
+	{
+		if (writer.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				mailbox.quit = true;
+			}
+			kick();
+			writer.join();
+		}
+		if (wake_fd != -1)
+			::close(wake_fd);
+		if (fd == -1)
+			return;
+		io.close(fd);
+	}
+	bool isValid() const override { return fd != -1 && !lost; }
+};
+#endif
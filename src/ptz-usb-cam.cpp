@@ -14,99 +14,6 @@
 #include <obs.hpp>
 #include "ptz-usb-cam.hpp"
 
-#ifdef __linux__
-#include <linux/v4l2-controls.h>
-#include <linux/videodev2.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
-#include <unistd.h>
-
-class V4L2Control : public PTZControl {
-private:
-	int fd;
-	int query_ctrl(unsigned int i, long *pmin, long *pmax)
-	{
-		if (fd == -1)
-			return false;
-		struct v4l2_queryctrl queryctrl = {};
-		queryctrl.id = i;
-		if (ioctl(fd, VIDIOC_QUERYCTRL, &queryctrl) == -1) {
-			blog(LOG_ERROR, "VIDIOC_QUERYCTRL failed for axis %d", i);
-			return -1;
-		}
-		*pmin = queryctrl.minimum;
-		*pmax = queryctrl.maximum;
-		return 0;
-	}
-	int set_ctrl(unsigned int i, long value)
-	{
-		if (fd == -1)
-			return false;
-		struct v4l2_control control = {};
-		control.id = i;
-		control.value = value;
-		if (ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
-			blog(LOG_ERROR, "Failed to set PTZ %d value", i);
-			return false;
-		}
-		return true;
-	}
-	int get_ctrl(unsigned int i)
-	{
-		if (fd == -1)
-			return 0;
-		struct v4l2_control control = {};
-		control.id = i;
-		if (ioctl(fd, VIDIOC_G_CTRL, &control) == -1) {
-			blog(LOG_ERROR, "VIDIOC_G_CTRL failed for axis %d", i);
-			return 0;
-		}
-		return control.value;
-	}
-
-public:
-	V4L2Control(const std::string &device)
-	{
-		device_path = device;
-		fd = open(device_path.c_str(), O_RDWR);
-		if (fd == -1) {
-			blog(LOG_ERROR, "Failed to open V4L2 device: %s", device_path.c_str());
-			return;
-		}
-		query_ctrl(V4L2_CID_PAN_ABSOLUTE, &min.pan, &max.pan);
-		query_ctrl(V4L2_CID_TILT_ABSOLUTE, &min.tilt, &max.tilt);
-		query_ctrl(V4L2_CID_ZOOM_ABSOLUTE, &min.zoom, &max.zoom);
-		query_ctrl(V4L2_CID_FOCUS_ABSOLUTE, &min.focus, &max.focus);
-		now_pos.pan = static_cast<double>(get_ctrl(V4L2_CID_PAN_ABSOLUTE)) / max.pan;
-		now_pos.tilt = static_cast<double>(get_ctrl(V4L2_CID_TILT_ABSOLUTE)) / max.tilt;
-		now_pos.zoom = static_cast<double>(get_ctrl(V4L2_CID_ZOOM_ABSOLUTE)) / max.zoom;
-		now_pos.focus = static_cast<double>(get_ctrl(V4L2_CID_FOCUS_ABSOLUTE)) / max.focus;
-		now_pos.focusAuto = get_ctrl(V4L2_CID_FOCUS_AUTO);
-	}
-	bool internal_pan(long value) override { return set_ctrl(V4L2_CID_PAN_ABSOLUTE, value); }
-	bool internal_tilt(long value) override { return set_ctrl(V4L2_CID_TILT_ABSOLUTE, value); }
-	bool internal_zoom(long value) override { return set_ctrl(V4L2_CID_ZOOM_ABSOLUTE, value); }
-	bool internal_focus(bool auto_focus, long value) override
-	{
-		if (auto_focus) {
-			return set_ctrl(V4L2_CID_FOCUS_AUTO, 1);
-		} else {
-			if (get_ctrl(V4L2_CID_FOCUS_AUTO) != 0) {
-				set_ctrl(V4L2_CID_FOCUS_AUTO, 0);
-			}
-			return set_ctrl(V4L2_CID_FOCUS_ABSOLUTE, value);
-		}
-	}
-	~V4L2Control() override
-	{
-		if (fd == -1)
-			return;
-		close(fd);
-	}
-	bool isValid() const override { return fd != -1; }
-};
-#endif
-
 #ifdef _WIN32
 #include <dshow.h>
 #pragma comment(lib, "strmiids.lib") // Linka com DirectShow no Windows
@@ -291,16 +198,36 @@ void PTZUSBCam::ptz_tick_callback(void *param, float seconds)
 	cam->ptz_tick(seconds);
 }
 
+void PTZUSBCam::source_changed_cb(void *data, calldata_t *cd)
+{
+	Q_UNUSED(cd);
+	static_cast<PTZUSBCam *>(data)->invalidate_ptz_control();
+}
+
 PTZUSBCam::PTZUSBCam(OBSData config) : PTZDevice(config)
 {
 	getDefaults(config);
 	update(config);
+	signal_handler_t *sh = obs_get_signal_handler();
+	signal_handler_connect(sh, "source_create", source_changed_cb, this);
+	signal_handler_connect(sh, "source_destroy", source_changed_cb, this);
+	signal_handler_connect(sh, "source_rename", source_changed_cb, this);
+	connect(this, &QObject::objectNameChanged, this, &PTZUSBCam::invalidate_ptz_control);
+	retry_timer.setSingleShot(true);
+	connect(&retry_timer, &QTimer::timeout, this, &PTZUSBCam::refresh_ptz_control);
 	obs_add_tick_callback(ptz_tick_callback, this);
 }
 
 PTZUSBCam::~PTZUSBCam()
 {
 	obs_remove_tick_callback(ptz_tick_callback, this);
+	signal_handler_t *sh = obs_get_signal_handler();
+	signal_handler_disconnect(sh, "source_create", source_changed_cb, this);
+	signal_handler_disconnect(sh, "source_destroy", source_changed_cb, this);
+	signal_handler_disconnect(sh, "source_rename", source_changed_cb, this);
+	watch_source(nullptr);
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
+	delete ptz_control_;
 }
 
 QString PTZUSBCam::description()
@@ -311,6 +238,7 @@ QString PTZUSBCam::description()
 void PTZUSBCam::update(OBSData config)
 {
 	PTZDevice::update(config);
+	invalidate_ptz_control();
 	OBSDataArrayAutoRelease presetArray = obs_data_get_array(config, "presets_memory");
 	size_t count = obs_data_array_count(presetArray);
 	for (size_t i = 0; i < count; ++i) {
@@ -363,10 +291,50 @@ void PTZUSBCam::do_update()
 	focus_changed = false;
 }
 
+/* Follow settings updates on the video source the control is taken from */
+void PTZUSBCam::watch_source(obs_source_t *source)
+{
+	OBSSourceAutoRelease prev = obs_weak_source_get_source(watched_source);
+	if (prev == source && source)
+		return;
+	/* A source that is already gone has taken its signal handler with it */
+	if (prev)
+		signal_handler_disconnect(obs_source_get_signal_handler(prev), "update", source_changed_cb, this);
+	watched_source = source ? obs_source_get_weak_source(source) : nullptr;
+	if (source)
+		signal_handler_connect(obs_source_get_signal_handler(source), "update", source_changed_cb, this);
+}
+
+/* Safe from any thread; repeated calls before the refresh runs coalesce */
+void PTZUSBCam::invalidate_ptz_control()
+{
+	if (!refresh_queued.exchange(true))
+		QMetaObject::invokeMethod(this, &PTZUSBCam::refresh_ptz_control, Qt::QueuedConnection);
+}
+
+/* Caller must hold control_lock for as long as it uses the result */
 PTZControl *PTZUSBCam::get_ptz_control()
 {
+	if (!ptz_control_)
+		return nullptr;
+	if (ptz_control_->isValid())
+		return ptz_control_;
+	/* Gone; look again unless a retry is already waiting */
+	if (!retry_armed.load(std::memory_order_relaxed))
+		invalidate_ptz_control();
+	return nullptr;
+}
+
+/* Device thread only */
+void PTZUSBCam::refresh_ptz_control()
+{
+	refresh_queued = false;
+	retry_timer.stop();
+	retry_armed = false;
+
 	std::string video_device_id = "";
 	OBSSourceAutoRelease src = obs_get_source_by_name(QT_TO_UTF8(objectName()));
+	watch_source(src);
 	if (src) {
 		OBSDataAutoRelease psettings = obs_source_get_settings(src);
 		if (psettings) {
@@ -378,30 +346,42 @@ PTZControl *PTZUSBCam::get_ptz_control()
 		}
 	}
 
-	// already have the device, and it didn't change: nothing to do
-	if (ptz_control_ != nullptr && ptz_control_->isValid() && ptz_control_->getDevicePath() == video_device_id) {
-		return ptz_control_;
-	}
-	blog(LOG_INFO, "Switching PTZ USBUVC device from %s to %s",
-	     ptz_control_ == nullptr ? "null" : ptz_control_->getDevicePath().c_str(),
-	     video_device_id.empty() ? "null" : video_device_id.c_str());
-	if (ptz_control_ != nullptr) {
-		delete ptz_control_;
+	PTZControl *old;
+	{
+		std::lock_guard<std::recursive_mutex> guard(control_lock);
+		// already have the device, and it didn't change: nothing to do
+		if (ptz_control_ && ptz_control_->isValid() && ptz_control_->getDevicePath() == video_device_id)
+			return;
+		blog(LOG_INFO, "Switching PTZ USBUVC device from %s to %s",
+		     ptz_control_ == nullptr ? "null" : ptz_control_->getDevicePath().c_str(),
+		     video_device_id.empty() ? "null" : video_device_id.c_str());
+		old = ptz_control_;
 		ptz_control_ = nullptr;
 	}
-	if (video_device_id.empty()) {
-		return nullptr;
-	}
+	/* Outside the lock; this may wait for a slow control transfer */
+	delete old;
+	if (video_device_id.empty())
+		return;
+
+	PTZControl *fresh = nullptr;
 #ifdef __linux__
-	ptz_control_ = new V4L2Control(video_device_id);
+	fresh = new V4L2Control(video_device_id);
 #endif
 #ifdef _WIN32
-	ptz_control_ = new DirectShowControl(video_device_id);
+	fresh = new DirectShowControl(video_device_id);
 #endif
-	if (ptz_control_ == nullptr || !ptz_control_->isValid()) {
-		return nullptr;
+	if (!fresh)
+		return;
+	if (fresh->isValid()) {
+		retry_delay_ms = 0;
+	} else {
+		/* 0.5 s doubling up to 8 s */
+		retry_delay_ms = std::clamp(retry_delay_ms * 2, 500, 8000);
+		retry_armed = true;
+		retry_timer.start(retry_delay_ms);
 	}
-	return ptz_control_;
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
+	ptz_control_ = fresh;
 }
 
 void PTZUSBCam::ptz_tick(float seconds)
@@ -409,26 +389,75 @@ void PTZUSBCam::ptz_tick(float seconds)
 	tick_elapsed += seconds;
 	if (tick_elapsed < 0.03f)
 		return;
-	if (pan_speed != 0.0 || tilt_speed != 0.0) {
-		pantilt_rel(pan_speed * tick_elapsed, tilt_speed * tick_elapsed);
-	}
-	if (zoom_speed != 0.0) {
-		auto ptzctrl = get_ptz_control();
-		if (ptzctrl) {
-			zoom_abs(ptzctrl->getZoom() + zoom_speed * tick_elapsed);
-		}
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
+	auto ptzctrl = get_ptz_control();
+	if (!ptzctrl) {
+		tick_elapsed = 0.0f;
+		return;
 	}
-	if (focus_speed != 0.0) {
-		auto ptzctrl = get_ptz_control();
-		if (ptzctrl) {
-			focus_abs(ptzctrl->getFocus() + focus_speed * tick_elapsed);
-		}
+	ptzctrl->sync();
+
+	/* Runs on the OBS tick thread; take one consistent copy of the speeds */
+	PTZMotion m = motion();
+	bool still = m.pan == 0.0 && m.tilt == 0.0 && m.zoom == 0.0 && m.focus == 0.0;
+	if (still && tick_idle) {
+		/* Nothing to drive; only pick up moves reported by the device */
+		tick_elapsed = 0.0f;
+		checkPosition(ptzctrl);
+		return;
 	}
+	tick_idle = still;
+	/* Cameras with speed controls move on their own; otherwise step the
+	 * position along by hand */
+	if (ptzctrl->hasPanTiltSpeed())
+		ptzctrl->panTiltSpeed(m.pan, m.tilt);
+	else if (m.pan != 0.0 || m.tilt != 0.0)
+		pantilt_rel(m.pan * tick_elapsed, m.tilt * tick_elapsed);
+	if (ptzctrl->hasZoomSpeed())
+		ptzctrl->zoomSpeed(m.zoom);
+	else if (m.zoom != 0.0)
+		zoom_abs(ptzctrl->getZoom() + m.zoom * tick_elapsed);
+	if (m.focus != 0.0)
+		focus_abs(ptzctrl->getFocus() + m.focus * tick_elapsed);
 	tick_elapsed = 0.0f;
+	checkPosition(ptzctrl);
+}
+
+/* Tick thread; hands position changes over to publishPosition() */
+void PTZUSBCam::checkPosition(PTZControl *ptzctrl)
+{
+	PtzUsbCamPos pos = ptzctrl->getPosition();
+	if (pos.pan == tick_pos.pan && pos.tilt == tick_pos.tilt && pos.zoom == tick_pos.zoom &&
+	    pos.focus == tick_pos.focus)
+		return;
+	tick_pos = pos;
+	if (!position_update_pending.exchange(true))
+		QMetaObject::invokeMethod(this, &PTZUSBCam::publishPosition, Qt::QueuedConnection);
+}
+
+/* Runs on the device's thread, queued from the tick */
+void PTZUSBCam::publishPosition()
+{
+	position_update_pending = false;
+	PtzUsbCamPos pos;
+	{
+		std::lock_guard<std::recursive_mutex> guard(control_lock);
+		if (!ptz_control_)
+			return;
+		pos = ptz_control_->getPosition();
+	}
+	OBSDataAutoRelease data = obs_data_create();
+	obs_data_set_double(data, "pan_pos", pos.pan);
+	obs_data_set_double(data, "tilt_pos", pos.tilt);
+	obs_data_set_double(data, "zoom_pos", pos.zoom);
+	obs_data_set_double(data, "focus_pos", pos.focus);
+	if (applySettings(data))
+		emit settingsChanged(data.Get());
 }
 
 void PTZUSBCam::pantilt_abs(double pan, double tilt)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
@@ -438,9 +467,14 @@ void PTZUSBCam::pantilt_abs(double pan, double tilt)
 
 void PTZUSBCam::pantilt_rel(double pan, double tilt)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
+	if (ptzctrl->hasPanTiltRelative()) {
+		ptzctrl->pantiltRelative(pan, tilt);
+		return;
+	}
 	pantilt_abs(ptzctrl->getPan() + pan, ptzctrl->getTilt() + tilt);
 }
 
@@ -451,6 +485,7 @@ void PTZUSBCam::pantilt_home()
 
 void PTZUSBCam::zoom_abs(double pos)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
@@ -459,6 +494,7 @@ void PTZUSBCam::zoom_abs(double pos)
 
 void PTZUSBCam::focus_abs(double pos)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
@@ -467,6 +503,7 @@ void PTZUSBCam::focus_abs(double pos)
 
 void PTZUSBCam::set_autofocus(bool enabled)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
@@ -482,6 +519,7 @@ void PTZUSBCam::memory_reset(int i)
 
 void PTZUSBCam::memory_set(int i)
 {
+	std::lock_guard<std::recursive_mutex> guard(control_lock);
 	auto ptzctrl = get_ptz_control();
 	if (!ptzctrl)
 		return;
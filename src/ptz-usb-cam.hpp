@@ -8,75 +8,13 @@
 
 #include <QObject>
 #include <QTcpSocket>
+#include <QTimer>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include "ptz-device.hpp"
-
-struct PtzUsbCamLimits {
-	long pan = 0;
-	long tilt = 0;
-	long zoom = 0;
-	long focus = 0;
-	// long temperature = 0;
-};
-
-struct PtzUsbCamPos {
-	double pan = 0;
-	double tilt = 0;
-	double zoom = 0;
-	bool focusAuto = true;
-	double focus = 0;
-	// bool whitebalAuto = true;
-	// double temperature = 0;
-};
-
-class PTZControl {
-protected:
-	std::string device_path;
-	PtzUsbCamLimits min, max;
-	PtzUsbCamPos now_pos;
-
-public:
-	virtual ~PTZControl() {}
-	virtual bool internal_pan(long value) = 0;
-	bool pan(double value)
-	{
-		now_pos.pan = std::clamp(value, -1.0, 1.0);
-		long pan = std::clamp(static_cast<long>(now_pos.pan * max.pan), min.pan, max.pan);
-		return internal_pan(pan);
-	}
-	double getPan() const { return now_pos.pan; }
-	virtual bool internal_tilt(long value) = 0;
-	bool tilt(double value)
-	{
-		now_pos.tilt = std::clamp(value, -1.0, 1.0);
-		long tilt = std::clamp(static_cast<long>(now_pos.tilt * max.tilt), min.tilt, max.tilt);
-		return internal_tilt(tilt);
-	}
-	double getTilt() const { return now_pos.tilt; }
-	virtual bool internal_zoom(long value) = 0;
-	bool zoom(double value)
-	{
-		now_pos.zoom = std::clamp(value, 0.0, 1.0);
-		long zoom = std::clamp(static_cast<long>(now_pos.zoom * max.zoom), min.zoom, max.zoom);
-		return internal_zoom(zoom);
-	}
-	double getZoom() const { return now_pos.zoom; }
-	virtual bool internal_focus(bool auto_focus, long value) = 0;
-	bool focus(double value)
-	{
-		now_pos.focus = std::clamp(value, 0.0, 1.0);
-		long focus = std::clamp(static_cast<long>(now_pos.focus * max.focus), min.focus, max.focus);
-		return internal_focus(false, focus);
-	}
-	double getFocus() const { return now_pos.focus; }
-	bool setAutoFocus(bool enabled)
-	{
-		long focus = std::clamp(static_cast<long>(now_pos.focus * max.focus), min.focus, max.focus);
-		return internal_focus(enabled, focus);
-	}
-	struct PtzUsbCamPos getPosition() const { return now_pos; }
-	std::string getDevicePath() { return device_path; }
-	virtual bool isValid() const = 0;
-};
+#include "ptz-usb-cam-control.hpp"
 
 class PTZUSBCam : public PTZDevice {
 	Q_OBJECT
@@ -86,7 +24,34 @@ private:
 	QMap<int, PtzUsbCamPos> presets;
 	double tick_elapsed = 0.0f;
 	PTZControl *ptz_control_ = nullptr;
+	/* The control is looked up from the video source with the same name
+	 * as this device. The lookup runs on the device's thread, and only
+	 * after something that can change the answer: a source being created,
+	 * destroyed or renamed, the source settings changing, or the device
+	 * going away. Replacing a control joins its writer thread, so that
+	 * never happens on the tick. */
+	std::atomic<bool> refresh_queued{false};
+	void refresh_ptz_control();
+	/* While the device is unplugged, reopening is retried with backoff */
+	QTimer retry_timer;
+	std::atomic<bool> retry_armed{false};
+	int retry_delay_ms = 0;
+	/* The tick and the UI both drive the control. Held around every use
+	 * and around swapping the pointer; recursive because the motion
+	 * helpers call each other. */
+	std::recursive_mutex control_lock;
+	/* Tick thread only; true once zero speeds have been sent */
+	bool tick_idle = false;
+	/* Last position the tick saw; changes are published to the snapshot
+	 * from the device's thread, at most one update queued at a time */
+	PtzUsbCamPos tick_pos;
+	std::atomic<bool> position_update_pending{false};
+	void publishPosition();
+	void checkPosition(PTZControl *ptzctrl);
+	OBSWeakSourceAutoRelease watched_source;
 	PTZControl *get_ptz_control();
+	void watch_source(obs_source_t *source);
+	static void source_changed_cb(void *data, calldata_t *cd);
 
 protected:
 	static void ptz_tick_callback(void *param, float seconds);
@@ -95,6 +60,7 @@ protected:
 public:
 	PTZUSBCam(OBSData config);
 	~PTZUSBCam();
+	void invalidate_ptz_control();
 	void save(obs_data_t *settings) const;
 	QString description() override;
 
@@ -11,6 +11,10 @@
 
 std::map<int, ViscaUDPSocket *> ViscaUDPSocket::interfaces;
 
+static const int stat_sent = PTZStatistics::registerCounter("visca_udp_sent_count");
+static const int stat_reset = PTZStatistics::registerCounter("visca_udp_reset_count");
+static const int stat_outofseq_cmplt = PTZStatistics::registerCounter("visca_udp_outofseq_cmplt_count");
+
 ViscaUDPSocket::ViscaUDPSocket(int port) : visca_port(port)
 {
 	if (!visca_socket.bind(QHostAddress::Any, visca_port)) {
@@ -47,7 +51,7 @@ void PTZViscaOverIP::receive_datagram(const QNetworkDatagram &dg)
 		if (seq != seq_state[0] && seq != seq_state[slot]) {
 			ptz_debug_trace("out of seq; %i != [0]%i or [%i]%i) <-- %s", seq, seq_state[0], slot,
 					seq_state[slot], qPrintable(data.toHex(':')));
-			incrementStatistic("visca_udp_outofseq_cmplt_count");
+			incrementStatistic(stat_outofseq_cmplt);
 			return;
 		}
 		/* if slot is nonzero, update or clear the sequence number for that slot */
@@ -124,7 +128,7 @@ void PTZViscaOverIP::reset()
 {
 	for (int i = 0; i < 8; i++)
 		seq_state[i] = 0;
-	incrementStatistic("visca_udp_reset_count");
+	incrementStatistic(stat_reset);
 	iface->send(ip_address, QByteArray::fromHex("020000010000000001"));
 	cmd_get_camera_info();
 }
@@ -134,7 +138,7 @@ void PTZViscaOverIP::send_immediate(const QByteArray &msg)
 	if (quirk_visca_udp_no_seq) {
 		// Don't prepend the sequence field
 		iface->send(ip_address, msg);
-		incrementStatistic("visca_udp_sent_count");
+		incrementStatistic(stat_sent);
 		return;
 	}
 	QByteArray p = QByteArray::fromHex("0100000000000000") + msg;
@@ -147,7 +151,7 @@ void PTZViscaOverIP::send_immediate(const QByteArray &msg)
 	p[7] = seq_state[0] & 0xff;
 	p[8] = '\x81';
 	iface->send(ip_address, p);
-	incrementStatistic("visca_udp_sent_count");
+	incrementStatistic(stat_sent);
 }
 
 void PTZViscaOverIP::lookup_host_callback(const QHostInfo info)
@@ -164,6 +164,9 @@ public:
 	visca_u16(const char *name, int offset) : int_field(name, offset, 0x0f0f0f0f) {}
 };
 
+static const int stat_sent = PTZStatistics::registerCounter("visca_sent_count");
+static const int stat_recv = PTZStatistics::registerCounter("visca_recv_count");
+
 const PTZCmd VISCA_ENUMERATE("883001ff");
 
 const PTZInq VISCA_CAM_VersionInq("81090002ff",
@@ -663,7 +666,7 @@ void PTZVisca::send(PTZCmd cmd, QList<int> args)
 void PTZVisca::send_packet(const QByteArray &packet)
 {
 	ptz_debug_trace("--> %s", packet.toHex(':').data());
-	incrementStatistic("visca_sent_count");
+	incrementStatistic(stat_sent);
 	send_immediate(packet);
 	timeout_timer.setSingleShot(true);
 	timeout_timer.start(1000 / 20); // Update 20 times a second
@@ -706,7 +709,7 @@ void PTZVisca::receive(const QByteArray &msg)
 	if (VISCA_PACKET_SENDER(msg) != address || (msg.size() < 3))
 		return;
 	ptz_debug_trace("<-- %s", msg.toHex(':').data());
-	incrementStatistic("visca_recv_count");
+	incrementStatistic(stat_recv);
 	int slot = msg[1] & 0x7;
 	QByteArray inq;
 
@@ -746,15 +749,16 @@ void PTZVisca::receive(const QByteArray &msg)
 			 * commands complete immediately. Only decode
 			 * response if the payload size is non-zero */
 			obs_data_t *rslt_props = active_cmd[0].value().decode(msg);
-			obs_data_apply(settings, rslt_props);
+			bool changed = applySettings(rslt_props);
 
 			/* Mark returned properties as clean */
 			for (auto item = obs_data_first(rslt_props); item; obs_data_item_next(&item))
 				stale_settings -= obs_data_item_get_name(item);
 
-			/* Data has been updated */
-			obs_data_set_obj(rslt_props, "statistics", statistics);
-			emit settingsChanged(rslt_props);
+			/* Polls mostly confirm what is already known; only tell
+			 * the UI when something moved */
+			if (changed)
+				emit settingsChanged(rslt_props);
 			obs_data_release(rslt_props);
 		}
 
@@ -780,13 +784,9 @@ void PTZVisca::receive(const QByteArray &msg)
 
 void PTZVisca::get(calldata_t *cd) const
 {
-	if (QThread::currentThread() != thread()) {
-		ptz_log(LOG_ERROR, "PTZVisca::get(calldata) called from non-GUI thread; ignored");
-		return;
-	}
 	QString arg = calldata_string(cd, "property");
 	if (arg == "wb_mode")
-		calldata_set_int(cd, "wb_mode", obs_data_get_int(settings, "wb_mode"));
+		calldata_set_int(cd, "wb_mode", obs_data_get_int(snapshot()->settings, "wb_mode"));
 	else
 		PTZDevice::get(cd);
 }
@@ -892,6 +892,7 @@ void PTZVisca::set_autofocus(bool enabled)
 {
 	send(enabled ? VISCA_CAM_Focus_Auto : VISCA_CAM_Focus_Manual);
 	obs_data_set_bool(settings, "focus_af_enabled", enabled);
+	publishState();
 }
 
 void PTZVisca::focus_onetouch()
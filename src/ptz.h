@@ -23,6 +23,7 @@ extern "C" {
 extern void ptz_load_devices(void);
 extern void ptz_unload_devices(void);
 extern void ptz_load_action_source(void);
+extern void ptz_unload_action_source(void);
 extern void ptz_load_controls(void);
 extern void ptz_load_settings(void);
 
@@ -30,8 +31,6 @@ extern obs_data_array_t *ptz_devices_get_config(void);
 extern obs_source_t *ptz_device_find_source_using_ptz_name(uint32_t device_id);
 extern void ptz_devices_set_config(obs_data_array_t *devices);
 
-extern bool ptz_scene_is_source_active(obs_source_t *scene, obs_source_t *source);
-
 extern proc_handler_t *ptz_get_proc_handler();
 
 #ifdef __cplusplus
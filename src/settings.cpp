@@ -14,6 +14,8 @@
 #include <QDesktopServices>
 #include <QStringList>
 #include <QJsonDocument>
+#include <QShowEvent>
+#include <QHideEvent>
 
 #include <string>
 
@@ -27,6 +29,11 @@
 #include "ptz-list-model.hpp"
 #include "ptz-controls.hpp"
 #include "settings.hpp"
+#include "ptz-discovery.hpp"
+#include "visca-discovery.hpp"
+#if defined(ENABLE_ONVIF)
+#include "onvif-discovery.hpp"
+#endif
 #include "ui_settings.h"
 
 /* ----------------------------------------------------------------- */
@@ -65,16 +72,15 @@ public:
 
 obs_properties_t *PTZSettings::getProperties(void)
 {
-	auto cb = [](obs_properties_t *, obs_property_t *, void *data_) {
-		auto data = static_cast<obs_data_t *>(data_);
-		blog(LOG_INFO, "%s", obs_data_get_string(data, "debug_info"));
+	auto cb = [](obs_properties_t *, obs_property_t *, void *data) {
+		blog(LOG_INFO, "%s", static_cast<PTZSettings *>(data)->debugInfo().constData());
 		return true;
 	};
 
 	auto props = ptzDeviceList.getProperties(ui->deviceList->currentIndex());
 	auto debug = obs_properties_create();
 	obs_properties_add_text(debug, "debug_info", NULL, OBS_TEXT_INFO);
-	obs_properties_add_button2(debug, "dbgdump", "Write to OBS log", cb, settings);
+	obs_properties_add_button2(debug, "dbgdump", "Write to OBS log", cb, this);
 	obs_properties_add_group(props, "debug", "Full Details", OBS_GROUP_NORMAL, debug);
 	return props;
 }
@@ -125,6 +131,9 @@ PTZSettings::PTZSettings() : QWidget(nullptr), ui(new Ui_PTZSettings)
 		static_cast<PTZSettings *>(obj)->updateProperties(oldset, newset);
 	};
 	propertiesView = new OBSPropertiesView(settings, this, reload_cb, update_cb);
+	refreshTimer.setSingleShot(true);
+	refreshTimer.setInterval(250);
+	connect(&refreshTimer, &QTimer::timeout, this, &PTZSettings::refreshStale);
 	propertiesView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	ui->propertiesLayout->insertWidget(0, propertiesView, 0);
 
@@ -370,6 +379,7 @@ void PTZSettings::on_addPTZ_clicked()
 	QAction *addViscaSerial = addPTZContext.addAction(obs_module_text("PTZ.Visca.Serial.Name"));
 #endif
 	QAction *addViscaUDP = addPTZContext.addAction(obs_module_text("PTZ.Visca.UDP.Name"));
+	QAction *discoverViscaUDP = addPTZContext.addAction(obs_module_text("PTZ.Visca.UDP.Discover"));
 	QAction *addViscaTCP = addPTZContext.addAction(obs_module_text("PTZ.Visca.TCP.Name"));
 #if defined(ENABLE_SERIALPORT)
 	QAction *addPelcoD = addPTZContext.addAction(obs_module_text("PTZ.PelcoD.Name"));
@@ -377,6 +387,7 @@ void PTZSettings::on_addPTZ_clicked()
 #endif
 #if defined(ENABLE_ONVIF) // ONVIF disabled until code is reworked
 	QAction *addOnvif = addPTZContext.addAction(obs_module_text("PTZ.ONVIF.Name"));
+	QAction *discoverOnvif = addPTZContext.addAction(obs_module_text("PTZ.ONVIF.Discover"));
 #endif
 #if defined(ENABLE_USB_CAM)
 	QAction *addUsbCam = addPTZContext.addAction(obs_module_text("PTZ.UVC.Name"));
@@ -398,6 +409,8 @@ void PTZSettings::on_addPTZ_clicked()
 		obs_data_set_int(cfg, "port", 52381);
 		ptzDeviceList.make_device(cfg);
 	}
+	if (action == discoverViscaUDP)
+		(new PTZDiscoveryDialog(new ViscaDiscovery(), obs_module_text("PTZ.Visca.UDP.Discover"), this))->show();
 	if (action == addViscaTCP) {
 		OBSData cfg = obs_data_create();
 		obs_data_release(cfg);
@@ -428,6 +441,8 @@ void PTZSettings::on_addPTZ_clicked()
 		obs_data_set_string(cfg, "type", "onvif");
 		ptzDeviceList.make_device(cfg);
 	}
+	if (action == discoverOnvif)
+		(new PTZDiscoveryDialog(new OnvifDiscovery(), obs_module_text("PTZ.ONVIF.Discover"), this))->show();
 #endif
 #if defined(ENABLE_USB_CAM)
 	if (action == addUsbCam) {
@@ -454,26 +469,72 @@ void PTZSettings::currentChanged(const QModelIndex &current, const QModelIndex &
 	obs_data_clear(settings);
 
 	ptzDeviceList.save(current, settings);
-	auto rawjson = obs_data_get_json(settings);
-	/* Use QJsonDocument for nice formatting */
-	auto json = QJsonDocument::fromJson(rawjson).toJson();
-	obs_data_set_string(settings, "debug_info", json.constData());
+	settingsStale = false;
+	debugStale = false;
+	obs_data_set_string(settings, "debug_info", debugInfo().constData());
 
 	propertiesView->ReloadProperties();
 }
 
-void PTZSettings::settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+void PTZSettings::settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles)
 {
+	/* Lock and scene state are not part of the device settings */
+	if (!roles.isEmpty() && !roles.contains(PTZListModel::SettingsRole) && !roles.contains(Qt::DisplayRole))
+		return;
 	auto idx = ui->deviceList->currentIndex();
 	QItemSelectionRange range(topLeft, bottomRight);
 	if (!range.contains(idx))
 		return;
 
-	ptzDeviceList.save(idx, settings);
-	obs_data_erase(settings, "debug_info");
-	auto json = QJsonDocument::fromJson(obs_data_get_json(settings)).toJson();
+	settingsStale = true;
+	debugStale = true;
+	if (isVisible() && !refreshTimer.isActive())
+		refreshTimer.start();
+}
+
+/* Full device config plus statistics, pretty printed for the debug view */
+QByteArray PTZSettings::debugInfo() const
+{
+	OBSDataAutoRelease data = obs_data_create();
+	auto idx = ui->deviceList->currentIndex();
+	ptzDeviceList.save(idx, data.Get());
+	PTZDevice *ptz = ptzDeviceList.getDevice(idx);
+	if (ptz)
+		obs_data_set_obj(data, "statistics", ptz->getStatistics());
+	/* Use QJsonDocument for nice formatting */
+	return QJsonDocument::fromJson(obs_data_get_json(data)).toJson();
+}
+
+void PTZSettings::refreshStale()
+{
+	if (settingsStale) {
+		settingsStale = false;
+		ptzDeviceList.save(ui->deviceList->currentIndex(), settings);
+		QMetaObject::invokeMethod(propertiesView, "RefreshProperties", Qt::QueuedConnection);
+	}
+
+	/* Scrolled out of view or on another tab; leave it for later */
+	auto label = qobject_cast<QLabel *>(propertiesView->GetPropertyWidget("debug_info"));
+	if (!debugStale || !label || !label->isVisible() || label->visibleRegion().isEmpty())
+		return;
+	debugStale = false;
+	auto json = debugInfo();
 	obs_data_set_string(settings, "debug_info", json.constData());
-	QMetaObject::invokeMethod(propertiesView, "RefreshProperties", Qt::QueuedConnection);
+	label->setText(QString::fromUtf8(json));
+}
+
+void PTZSettings::showEvent(QShowEvent *event)
+{
+	/* Catch up on anything that changed while hidden */
+	if (settingsStale || debugStale)
+		refreshTimer.start();
+	QWidget::showEvent(event);
+}
+
+void PTZSettings::hideEvent(QHideEvent *event)
+{
+	refreshTimer.stop();
+	QWidget::hideEvent(event);
 }
 
 void PTZSettings::showDevice(const QModelIndex &index)
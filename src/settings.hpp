@@ -10,6 +10,7 @@
 #include <QStyledItemDelegate>
 #include <QString>
 #include <QMenu>
+#include <QTimer>
 #include <properties-view.hpp>
 #if defined(ENABLE_JOYSTICK)
 #include <QStringListModel>
@@ -45,6 +46,19 @@ private:
 	OBSPropertiesView *propertiesView = nullptr;
 	void current_device_changed();
 
+	/* Device updates mark the page stale and arm refreshTimer, which
+	 * fires once per burst while the window is shown. The debug JSON is
+	 * regenerated only when its label is actually on screen. */
+	QTimer refreshTimer;
+	bool settingsStale = false;
+	bool debugStale = true;
+	void refreshStale();
+	QByteArray debugInfo() const;
+
+protected:
+	void showEvent(QShowEvent *event) override;
+	void hideEvent(QHideEvent *event) override;
+
 public:
 	PTZSettings();
 	~PTZSettings();
@@ -77,7 +91,7 @@ public slots:
 	void on_applyButton_clicked();
 
 	void currentChanged(const QModelIndex &current, const QModelIndex &previous);
-	void settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+	void settingsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
 	obs_properties_t *getProperties(void);
 	void updateProperties(OBSData old_settings, OBSData new_settings);
 	void showDevice(const QModelIndex &index);
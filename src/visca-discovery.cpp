@@ -0,0 +1,131 @@
+/* VISCA over IP network discovery
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <QNetworkDatagram>
+#include <QNetworkInterface>
+#include <obs-module.h>
+#include <qt-wrappers.hpp>
+#include "visca-discovery.hpp"
+
+static const quint16 discoveryPort = 52380;
+static const int viscaPort = 52381;
+
+ViscaDiscovery::ViscaDiscovery()
+{
+	connect(&socket, &QUdpSocket::readyRead, this, &ViscaDiscovery::readPending);
+	connect(&listener, &QUdpSocket::readyRead, this, &ViscaDiscovery::readPending);
+	probeTimer.setInterval(500);
+	connect(&probeTimer, &QTimer::timeout, this, &ViscaDiscovery::sendProbe);
+	deadline.setSingleShot(true);
+	deadline.setInterval(3000);
+	connect(&deadline, &QTimer::timeout, this, [this]() {
+		stop();
+		emit finished();
+	});
+}
+
+void ViscaDiscovery::start()
+{
+	stop();
+	if (!socket.bind(QHostAddress(QHostAddress::AnyIPv4), 0)) {
+		blog(LOG_WARNING, "[obs-ptz] VISCA discovery: cannot open UDP socket: %s",
+		     qPrintable(socket.errorString()));
+		emit finished();
+		return;
+	}
+	/* Not fatal; only cameras that broadcast their reply are missed */
+	if (!listener.bind(QHostAddress(QHostAddress::AnyIPv4), discoveryPort,
+			   QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+		blog(LOG_INFO, "[obs-ptz] VISCA discovery: cannot listen on port %i: %s", discoveryPort,
+		     qPrintable(listener.errorString()));
+	devices.clear();
+	probesSent = 0;
+	sendProbe();
+	probeTimer.start();
+	deadline.start();
+}
+
+void ViscaDiscovery::stop()
+{
+	probeTimer.stop();
+	deadline.stop();
+	socket.close();
+	listener.close();
+}
+
+void ViscaDiscovery::sendProbe()
+{
+	if (++probesSent >= 3)
+		probeTimer.stop();
+
+	static const QByteArray enq("\x02" "ENQ:network" "\xff\x03");
+
+	/* The limited broadcast address only goes out of the default route
+	 * interface on some systems, so also hit each subnet directly. */
+	socket.writeDatagram(enq, QHostAddress::Broadcast, discoveryPort);
+	for (const QNetworkInterface &iface : QNetworkInterface::allInterfaces()) {
+		if (!(iface.flags() & QNetworkInterface::IsUp) || !(iface.flags() & QNetworkInterface::CanBroadcast))
+			continue;
+		for (const QNetworkAddressEntry &entry : iface.addressEntries()) {
+			if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol && !entry.broadcast().isNull())
+				socket.writeDatagram(enq, entry.broadcast(), discoveryPort);
+		}
+	}
+}
+
+void ViscaDiscovery::readPending()
+{
+	QUdpSocket *sock = qobject_cast<QUdpSocket *>(sender());
+	while (sock->hasPendingDatagrams()) {
+		QNetworkDatagram dg = sock->receiveDatagram();
+		handleReply(dg.data(), dg.senderAddress());
+	}
+}
+
+void ViscaDiscovery::handleReply(const QByteArray &datagram, const QHostAddress &sender)
+{
+	/* Reply format: 0x02 {KEY:value 0xff}... 0x03 */
+	if (datagram.size() < 3 || datagram.front() != '\x02' || datagram.back() != '\x03')
+		return;
+
+	QHash<QByteArray, QString> fields;
+	for (const QByteArray &field : datagram.mid(1, datagram.size() - 2).split('\xff')) {
+		qsizetype colon = field.indexOf(':');
+		if (colon > 0)
+			fields.insert(field.left(colon), QString::fromLatin1(field.mid(colon + 1)).trimmed());
+	}
+	/* Our own query comes back in on the shared port */
+	if (fields.contains("ENQ"))
+		return;
+
+	QString host = fields.value("IPADR");
+	if (QHostAddress(host).isNull())
+		host = QHostAddress(sender.toIPv4Address()).toString();
+	QString key = fields.value("MAC", host);
+	QString name = fields.value("NAME");
+	QString model = fields.value("MODEL");
+
+	QString what = name.isEmpty() ? model : (model.isEmpty() ? name : QString("%1 - %2").arg(model, name));
+	if (what.isEmpty())
+		what = obs_module_text("PTZ.Visca.UDP.Name");
+	QString label = QString("%1 (%2)").arg(what, host);
+	if (fields.contains("MAC"))
+		label += " " + key;
+
+	/* Answers to the repeated probes are identical; only report changes */
+	if (devices.value(key) == label)
+		return;
+	devices.insert(key, label);
+
+	OBSDataAutoRelease cfg = obs_data_create();
+	obs_data_set_string(cfg, "type", "visca-over-ip");
+	obs_data_set_string(cfg, "host", QT_TO_UTF8(host));
+	obs_data_set_int(cfg, "port", viscaPort);
+	if (!name.isEmpty())
+		obs_data_set_string(cfg, "name", QT_TO_UTF8(name));
+	emit found(key, label, cfg.Get());
+}
@@ -0,0 +1,42 @@
+/* VISCA over IP network discovery
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+#pragma once
+
+#include <QUdpSocket>
+#include <QTimer>
+#include <QHash>
+#include "ptz-discovery.hpp"
+
+/*
+ * Finds Sony protocol VISCA cameras by broadcasting "ENQ:network" on
+ * udp/52380. Cameras answer with a list of KEY:value fields (MAC, IPADR,
+ * MODEL, NAME...). Depending on the firmware the answer is either sent back
+ * to the querying port or broadcast to 52380, so both are listened on.
+ */
+class ViscaDiscovery : public PTZDiscovery {
+	Q_OBJECT
+
+private:
+	QUdpSocket socket;
+	QUdpSocket listener;
+	QTimer probeTimer;
+	QTimer deadline;
+	int probesSent = 0;
+	/* Last label reported for each camera, keyed by MAC address */
+	QHash<QString, QString> devices;
+
+	void sendProbe();
+	void handleReply(const QByteArray &datagram, const QHostAddress &sender);
+
+private slots:
+	void readPending();
+
+public:
+	ViscaDiscovery();
+	void start() override;
+	void stop() override;
+};
@@ -0,0 +1,297 @@
+/* Exercises V4L2Control against a fake camera
+ *
+ * Copyright 2026 Grant Likely <grant.likely@secretlab.ca>
+ *
+ * SPDX-License-Identifier: GPLv2
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+#include "ptz-usb-cam-control.hpp"
+
+/*
+ * Camera with pan, tilt, zoom and focus controls and no speed or relative
+ * controls. Every control write is recorded so the tests can check what the
+ * writer thread sent. The device fd is not a real descriptor; poll() reports
+ * it readable while control events are queued and hands anything else to the
+ * system, which covers the writer's eventfd.
+ */
+class FakeV4L2Io : public V4L2Io {
+public:
+	static constexpr int device_fd = 1000;
+	using Batch = std::vector<std::pair<unsigned int, long>>;
+
+	std::mutex lock;
+	std::map<unsigned int, std::pair<long, long>> ranges = {
+		{V4L2_CID_PAN_ABSOLUTE, {-36000, 36000}},
+		{V4L2_CID_TILT_ABSOLUTE, {-36000, 36000}},
+		{V4L2_CID_ZOOM_ABSOLUTE, {0, 100}},
+		{V4L2_CID_FOCUS_ABSOLUTE, {0, 255}},
+		{V4L2_CID_FOCUS_AUTO, {0, 1}},
+	};
+	std::map<unsigned int, long> values;
+	std::vector<Batch> ext_calls;
+	Batch single_calls;
+	std::deque<struct v4l2_event> events;
+	/* S_EXT_CTRLS failure to inject; error_idx of count means nothing
+	 * was applied */
+	int ext_errno = 0;
+	unsigned int ext_error_idx = 0;
+	/* Keep the writer asleep so several posts land in one batch */
+	std::atomic<bool> hold{false};
+
+	int open(const char *, int) override { return device_fd; }
+	int close(int fd) override { return fd == device_fd ? 0 : ::close(fd); }
+
+	int ioctl(int fd, unsigned long request, void *arg) override
+	{
+		if (fd != device_fd)
+			return fail(EBADF);
+		std::lock_guard<std::mutex> guard(lock);
+		switch (request) {
+		case VIDIOC_QUERYCTRL: {
+			auto q = static_cast<struct v4l2_queryctrl *>(arg);
+			auto r = ranges.find(q->id);
+			if (r == ranges.end())
+				return fail(EINVAL);
+			q->minimum = r->second.first;
+			q->maximum = r->second.second;
+			return 0;
+		}
+		case VIDIOC_G_CTRL: {
+			auto c = static_cast<struct v4l2_control *>(arg);
+			if (!ranges.count(c->id))
+				return fail(EINVAL);
+			c->value = values[c->id];
+			return 0;
+		}
+		case VIDIOC_S_CTRL: {
+			auto c = static_cast<struct v4l2_control *>(arg);
+			if (!ranges.count(c->id))
+				return fail(EINVAL);
+			values[c->id] = c->value;
+			single_calls.push_back({c->id, c->value});
+			return 0;
+		}
+		case VIDIOC_S_EXT_CTRLS: {
+			auto ext = static_cast<struct v4l2_ext_controls *>(arg);
+			Batch batch;
+			for (unsigned int i = 0; i < ext->count; i++) {
+				/* v4l2_ext_control is packed, so copy the fields out */
+				unsigned int id = ext->controls[i].id;
+				long value = ext->controls[i].value;
+				batch.push_back({id, value});
+			}
+			ext_calls.push_back(batch);
+			if (ext_errno == ENOTTY)
+				return fail(ENOTTY);
+			unsigned int applied = ext->count;
+			if (ext_errno) {
+				ext->error_idx = std::min(ext_error_idx, ext->count);
+				applied = ext->error_idx < ext->count ? ext->error_idx : 0;
+			}
+			for (unsigned int i = 0; i < applied; i++)
+				values[batch[i].first] = batch[i].second;
+			return ext_errno ? fail(ext_errno) : 0;
+		}
+		case VIDIOC_SUBSCRIBE_EVENT:
+			return 0;
+		case VIDIOC_DQEVENT:
+			if (events.empty())
+				return fail(ENOENT);
+			*static_cast<struct v4l2_event *>(arg) = events.front();
+			events.pop_front();
+			return 0;
+		}
+		return fail(ENOTTY);
+	}
+
+	int poll(struct pollfd *fds, nfds_t nfds, int timeout) override
+	{
+		(void)timeout;
+		for (;;) {
+			int ready = 0;
+			for (nfds_t i = 0; i < nfds; i++) {
+				fds[i].revents = 0;
+				if (fds[i].fd == device_fd) {
+					std::lock_guard<std::mutex> guard(lock);
+					if (!events.empty())
+						fds[i].revents = POLLPRI;
+				} else if (!hold && fds[i].fd >= 0) {
+					::poll(&fds[i], 1, 0);
+				}
+				if (fds[i].revents)
+					ready++;
+			}
+			if (ready)
+				return ready;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	void queueEvent(unsigned int id, long value)
+	{
+		struct v4l2_event ev = {};
+		ev.type = V4L2_EVENT_CTRL;
+		ev.id = id;
+		ev.u.ctrl.changes = V4L2_EVENT_CTRL_CH_VALUE;
+		ev.u.ctrl.value = value;
+		std::lock_guard<std::mutex> guard(lock);
+		events.push_back(ev);
+	}
+
+private:
+	static int fail(int err)
+	{
+		errno = err;
+		return -1;
+	}
+};
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+	do {                                                                  \
+		if (!(cond)) {                                                \
+			fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			failures++;                                           \
+		}                                                             \
+	} while (0)
+
+/* The writer runs on its own thread; give it a moment to catch up */
+static bool waitFor(const std::function<bool()> &done)
+{
+	for (int i = 0; i < 1000; i++) {
+		if (done())
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+static size_t extCalls(FakeV4L2Io &io)
+{
+	std::lock_guard<std::mutex> guard(io.lock);
+	return io.ext_calls.size();
+}
+
+static size_t singleCalls(FakeV4L2Io &io)
+{
+	std::lock_guard<std::mutex> guard(io.lock);
+	return io.single_calls.size();
+}
+
+/* Targets posted while the writer is busy go out together */
+static void testBatching()
+{
+	FakeV4L2Io io;
+	V4L2Control ctrl("/dev/fake", io);
+	CHECK(ctrl.isValid());
+
+	io.hold = true;
+	ctrl.pan(0.5);
+	ctrl.tilt(-0.25);
+	ctrl.zoom(0.5);
+	ctrl.pan(0.75);
+	io.hold = false;
+
+	CHECK(waitFor([&] { return extCalls(io) == 1; }));
+	std::lock_guard<std::mutex> guard(io.lock);
+	FakeV4L2Io::Batch expect = {
+		{V4L2_CID_PAN_ABSOLUTE, 27000},
+		{V4L2_CID_TILT_ABSOLUTE, -9000},
+		{V4L2_CID_ZOOM_ABSOLUTE, 50},
+	};
+	CHECK(io.ext_calls.size() == 1 && io.ext_calls[0] == expect);
+	CHECK(io.single_calls.empty());
+}
+
+/* Controls after error_idx are retried one at a time; when validation fails
+ * before anything is applied the whole batch is */
+static void testPartialFailure()
+{
+	FakeV4L2Io io;
+	V4L2Control ctrl("/dev/fake", io);
+	io.ext_errno = EIO;
+	io.ext_error_idx = 1;
+
+	io.hold = true;
+	ctrl.pan(0.5);
+	ctrl.tilt(0.5);
+	ctrl.zoom(1.0);
+	io.hold = false;
+
+	CHECK(waitFor([&] { return singleCalls(io) == 2; }));
+	{
+		std::lock_guard<std::mutex> guard(io.lock);
+		FakeV4L2Io::Batch expect = {{V4L2_CID_TILT_ABSOLUTE, 18000}, {V4L2_CID_ZOOM_ABSOLUTE, 100}};
+		CHECK(io.single_calls == expect);
+		CHECK(io.values[V4L2_CID_PAN_ABSOLUTE] == 18000);
+		io.single_calls.clear();
+		io.ext_errno = EINVAL;
+		io.ext_error_idx = 2;
+	}
+
+	io.hold = true;
+	ctrl.pan(-0.5);
+	ctrl.tilt(-0.5);
+	io.hold = false;
+
+	CHECK(waitFor([&] { return singleCalls(io) == 2; }));
+	std::lock_guard<std::mutex> guard(io.lock);
+	FakeV4L2Io::Batch expect = {{V4L2_CID_PAN_ABSOLUTE, -18000}, {V4L2_CID_TILT_ABSOLUTE, -18000}};
+	CHECK(io.single_calls == expect);
+	CHECK(io.ext_calls.size() == 2);
+}
+
+/* A driver without extended controls is asked once, then only gets S_CTRL */
+static void testNoExtCtrls()
+{
+	FakeV4L2Io io;
+	V4L2Control ctrl("/dev/fake", io);
+	io.ext_errno = ENOTTY;
+
+	io.hold = true;
+	ctrl.pan(0.5);
+	ctrl.tilt(0.5);
+	io.hold = false;
+	CHECK(waitFor([&] { return singleCalls(io) == 2; }));
+
+	ctrl.zoom(0.5);
+	CHECK(waitFor([&] { return singleCalls(io) == 3; }));
+	std::lock_guard<std::mutex> guard(io.lock);
+	CHECK(io.ext_calls.size() == 1);
+	CHECK(io.values[V4L2_CID_ZOOM_ABSOLUTE] == 50);
+}
+
+/* Moves reported by the device reach the cached position through sync() */
+static void testEvents()
+{
+	FakeV4L2Io io;
+	V4L2Control ctrl("/dev/fake", io);
+
+	io.queueEvent(V4L2_CID_PAN_ABSOLUTE, 9000);
+	io.queueEvent(V4L2_CID_ZOOM_ABSOLUTE, 25);
+	io.queueEvent(V4L2_CID_FOCUS_ABSOLUTE, 51);
+	CHECK(waitFor([&] {
+		ctrl.sync();
+		return ctrl.getPan() == 0.25 && ctrl.getZoom() == 0.25 && ctrl.getFocus() == 0.2;
+	}));
+	CHECK(ctrl.getTilt() == 0.0);
+}
+
+int main()
+{
+	testBatching();
+	testPartialFailure();
+	testNoExtCtrls();
+	testEvents();
+	if (failures)
+		fprintf(stderr, "%d check(s) failed\n", failures);
+	return failures ? 1 : 0;
+}